@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "chart.h"
+#include "chart_vox.h"
+
+// the chart parser from before charts were parsed in place from a mapped file, kept as a reference for chart_bench
+// reads the file line by line with fgets, splits values with strtok, and allocates every value type to a fixed maximum
+// charts from it are freed with baseline_chart_free, not chart_free
+
+// max values
+#define BASELINE_CHART_STR_MAX 1024
+#define BASELINE_CHART_EVENTS_MAX 256
+#define BASELINE_CHART_ANALOG_POINTS_MAX 16
+
+// was 1024, raised so the reference can parse synthetic charts with up to SYNTHETIC_CHART_MAX_NOTES notes
+#define BASELINE_CHART_NOTES_MAX 8192
+
+typedef struct
+{
+    // the current section the parser is in
+    VoxSection section;
+
+    // the format version of the parsing vox file
+    uint8_t format_version;
+
+    // the currently building analogs for each lane
+    Analog *building_analogs[CHART_ANALOG_LANES];
+} BaselineVoxParsingState;
+
+void *baseline_vox_parsing_state_create();
+void baseline_vox_parsing_state_free(void *parsing_state);
+void baseline_vox_parse_line(Chart *chart, void *parsing_state, char *line);
+
+Chart *baseline_chart_create(const char *path);
+void baseline_chart_free(Chart *chart);
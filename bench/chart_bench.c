@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+
+#include "chart.h"
+#include "chart_cache.h"
+#include "timing.h"
+#include "synthetic_chart.h"
+#include "baseline_chart.h"
+
+// the number of times each chart is parsed by each parser when not given
+#define CHART_BENCH_DEFAULT_RUNS 20
+
+// the number of notes in each synthetic chart that is parsed when no charts are given
+static const int synthetic_chart_notes[] = { 1000, 3000, 10000, SYNTHETIC_CHART_MAX_NOTES };
+#define CHART_BENCH_NUM_SYNTHETIC_CHARTS (sizeof(synthetic_chart_notes) / sizeof(synthetic_chart_notes[0]))
+
+typedef struct
+{
+    // the paths of the charts to parse
+    char **paths;
+    int num_paths;
+    int max_paths;
+} ChartBenchCorpus;
+
+void corpus_add(ChartBenchCorpus *corpus, const char *path)
+{
+    // grow the paths if they are full
+    if (corpus->num_paths == corpus->max_paths)
+    {
+        corpus->max_paths = (corpus->max_paths > 0) ? corpus->max_paths * 2 : 16;
+        corpus->paths = realloc(corpus->paths, corpus->max_paths * sizeof(char *));
+    }
+
+    corpus->paths[corpus->num_paths++] = strdup(path);
+}
+
+int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+void corpus_add_directory(ChartBenchCorpus *corpus, const char *path)
+{
+    DIR *directory = opendir(path);
+    if (!directory)
+    {
+        printf("corpus_add_directory: unable to open %s\n", path);
+        return;
+    }
+
+    // add every vox file in the directory, sorted so runs are comparable
+    int first = corpus->num_paths;
+    struct dirent *entry;
+    while ((entry = readdir(directory)))
+    {
+        const char *extension = strrchr(entry->d_name, '.');
+        if (!extension || strcmp(extension, ".vox") != 0)
+            continue;
+
+        char chart_path[PATH_MAX];
+        if (snprintf(chart_path, sizeof(chart_path), "%s/%s", path, entry->d_name) < sizeof(chart_path))
+            corpus_add(corpus, chart_path);
+    }
+
+    closedir(directory);
+    qsort(corpus->paths + first, corpus->num_paths - first, sizeof(char *), compare_paths);
+}
+
+int compare_durations(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+int chart_num_notes(Chart *chart)
+{
+    int num_notes = 0;
+    for (int l = 0; l < CHART_BT_LANES; l++)
+        num_notes += chart->num_bt_notes[l];
+    for (int l = 0; l < CHART_FX_LANES; l++)
+        num_notes += chart->num_fx_notes[l];
+
+    return num_notes;
+}
+
+bool notes_equal(Note *a, Note *b, int num_notes)
+{
+    for (int i = 0; i < num_notes; i++)
+        if (a[i].start_subbeat != b[i].start_subbeat ||
+            a[i].start_time != b[i].start_time ||
+            a[i].hold != b[i].hold ||
+            (a[i].hold && a[i].end_subbeat != b[i].end_subbeat))
+            return false;
+
+    return true;
+}
+
+bool charts_equal(Chart *a, Chart *b)
+{
+    // compare the values that both parsers produce, to make sure they are timing the same work
+    if (a->num_beats != b->num_beats ||
+        a->num_tempos != b->num_tempos ||
+        a->end_subbeat != b->end_subbeat ||
+        a->main_bpm != b->main_bpm)
+        return false;
+
+    for (int l = 0; l < CHART_BT_LANES; l++)
+        if (a->num_bt_notes[l] != b->num_bt_notes[l] || !notes_equal(a->bt_notes[l], b->bt_notes[l], a->num_bt_notes[l]))
+            return false;
+
+    for (int l = 0; l < CHART_FX_LANES; l++)
+        if (a->num_fx_notes[l] != b->num_fx_notes[l] || !notes_equal(a->fx_notes[l], b->fx_notes[l], a->num_fx_notes[l]))
+            return false;
+
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+    {
+        if (a->num_analogs[l] != b->num_analogs[l])
+            return false;
+
+        for (int i = 0; i < a->num_analogs[l]; i++)
+            if (a->analogs[l][i].num_points != b->analogs[l][i].num_points)
+                return false;
+    }
+
+    return true;
+}
+
+// compare parsing charts with the baseline parser against chart_create, with the chart cache bypassed so every run parses the source
+// usage: chart_bench [-n runs] [chart or directory of charts]...
+// without any charts a corpus of synthetic charts is written and parsed
+int main(int argc, char **argv)
+{
+    int runs = CHART_BENCH_DEFAULT_RUNS;
+    int option;
+    while ((option = getopt(argc, argv, "n:")) != -1)
+    {
+        if (option != 'n')
+        {
+            printf("usage: %s [-n runs] [chart or directory of charts]...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        runs = atoi(optarg);
+    }
+
+    if (runs < 1)
+        runs = 1;
+
+    // get the charts to parse
+    ChartBenchCorpus corpus = { 0 };
+    bool synthetic = optind >= argc;
+
+    if (synthetic)
+    {
+        for (int i = 0; i < CHART_BENCH_NUM_SYNTHETIC_CHARTS; i++)
+        {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "chart_bench_%d.vox", synthetic_chart_notes[i]);
+
+            if (!synthetic_chart_write(path, synthetic_chart_notes[i]))
+                return EXIT_FAILURE;
+
+            corpus_add(&corpus, path);
+        }
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        struct stat path_stat;
+        if (stat(argv[i], &path_stat) == 0 && S_ISDIR(path_stat.st_mode))
+            corpus_add_directory(&corpus, argv[i]);
+        else
+            corpus_add(&corpus, argv[i]);
+    }
+
+    // parse the source every run
+    chart_cache_set_enabled(false);
+
+    printf("chart_bench: %d charts, %d runs each, times in ms\n", corpus.num_paths, runs);
+    printf("%-40s %8s %10s %10s %10s %10s %8s\n", "chart", "notes", "old min", "old median", "new min", "new median", "speedup");
+
+    int64_t *old_durations = malloc(sizeof(int64_t) * runs);
+    int64_t *new_durations = malloc(sizeof(int64_t) * runs);
+    int64_t old_total = 0, new_total = 0;
+
+    for (int c = 0; c < corpus.num_paths; c++)
+    {
+        const char *path = corpus.paths[c];
+        int num_notes = 0;
+        bool equal = true;
+
+        // alternate the parsers each run so neither is favoured by the state of the caches
+        for (int i = 0; i < runs; i++)
+        {
+            int64_t start = time_nanoseconds();
+            Chart *old_chart = baseline_chart_create(path);
+            old_durations[i] = time_nanoseconds() - start;
+
+            start = time_nanoseconds();
+            Chart *new_chart = chart_create(path);
+            new_durations[i] = time_nanoseconds() - start;
+
+            num_notes = chart_num_notes(new_chart);
+            equal &= charts_equal(old_chart, new_chart);
+
+            baseline_chart_free(old_chart);
+            chart_free(new_chart);
+        }
+
+        // report the durations of each parser
+        qsort(old_durations, runs, sizeof(int64_t), compare_durations);
+        qsort(new_durations, runs, sizeof(int64_t), compare_durations);
+
+        int64_t old_median = old_durations[runs / 2];
+        int64_t new_median = new_durations[runs / 2];
+        old_total += old_median;
+        new_total += new_median;
+
+        const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+        printf("%-40.40s %8d %10.3f %10.3f %10.3f %10.3f %7.2fx%s\n",
+               name,
+               num_notes,
+               time_nanoseconds_to_milliseconds(old_durations[0]),
+               time_nanoseconds_to_milliseconds(old_median),
+               time_nanoseconds_to_milliseconds(new_durations[0]),
+               time_nanoseconds_to_milliseconds(new_median),
+               (double)old_median / new_median,
+               equal ? "" : " (charts differ)");
+    }
+
+    // report the totals of the medians
+    if (corpus.num_paths > 1)
+        printf("%-40s %8s %10s %10.3f %10s %10.3f %7.2fx\n",
+               "total",
+               "",
+               "",
+               time_nanoseconds_to_milliseconds(old_total),
+               "",
+               time_nanoseconds_to_milliseconds(new_total),
+               (double)old_total / new_total);
+
+    free(old_durations);
+    free(new_durations);
+
+    // remove the synthetic charts and free the corpus
+    for (int c = 0; c < corpus.num_paths; c++)
+    {
+        if (synthetic)
+            unlink(corpus.paths[c]);
+
+        free(corpus.paths[c]);
+    }
+
+    free(corpus.paths);
+    return EXIT_SUCCESS;
+}
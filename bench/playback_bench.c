@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <GLES2/gl2.h>
+
+#include "chart.h"
+#include "chart_cache.h"
+#include "audio_track.h"
+#include "screen.h"
+#include "track.h"
+#include "scoring.h"
+#include "playback.h"
+#include "frame_stats.h"
+#include "timing.h"
+#include "synthetic_chart.h"
+
+// the path that the synthetic chart is written to
+#define PLAYBACK_BENCH_SYNTHETIC_PATH "playback_bench.vox"
+
+// the number of notes in the synthetic chart when not given
+#define PLAYBACK_BENCH_DEFAULT_NOTES 10000
+
+// the scroll speed to play the chart at
+#define PLAYBACK_BENCH_SPEED 1.5
+
+//
+// AUDIO TRACK
+// the bench is linked without audio_track.c, so the chart is played without audio
+// the position never changes, so the clock is never corrected and runs exactly as the bench steps it
+//
+
+AudioTrack *audio_track_create(const char *path)
+{
+    return malloc(sizeof(AudioTrack));
+}
+
+void audio_track_free(AudioTrack *track)
+{
+    free(track);
+}
+
+void audio_track_play(AudioTrack *track)
+{
+}
+
+double audio_track_position(AudioTrack *track)
+{
+    return 0;
+}
+
+// time playback_update playing a synthetic chart from start to end, one frame duration of chart time per update
+// usage: playback_bench [notes]
+// frames are not swapped, so the chart plays as fast as it can be updated and drawn
+int main(int argc, char **argv)
+{
+    int num_notes = (argc > 1) ? atoi(argv[1]) : PLAYBACK_BENCH_DEFAULT_NOTES;
+    if (num_notes < 0 || num_notes > SYNTHETIC_CHART_MAX_NOTES)
+    {
+        printf("playback_bench: the number of notes must be from 0 to %d\n", SYNTHETIC_CHART_MAX_NOTES);
+        return EXIT_FAILURE;
+    }
+
+    // write and load the synthetic chart, without a cache so it is never stale
+    if (!synthetic_chart_write(PLAYBACK_BENCH_SYNTHETIC_PATH, num_notes))
+        return EXIT_FAILURE;
+
+    chart_cache_set_enabled(false);
+    Chart *chart = chart_create(PLAYBACK_BENCH_SYNTHETIC_PATH);
+    unlink(PLAYBACK_BENCH_SYNTHETIC_PATH);
+
+    // create the playback
+    Screen *screen = screen_create();
+    Track *track = track_create(chart);
+    Scoring *scoring = scoring_create(chart);
+    AudioTrack *audio_track = audio_track_create(NULL);
+    FrameStats *frame_stats = frame_stats_create();
+
+    Playback *playback = playback_create(chart, audio_track, track, scoring);
+    playback_set_speed(playback, PLAYBACK_BENCH_SPEED);
+    playback_set_frame_stats(playback, frame_stats);
+    playback_start(playback, 0);
+
+    // play the chart, stepping the clock by a frame each update
+    // waiting for each frame to finish drawing stands in for swapping, so draws are not queued up across frames
+    int num_frames = 0;
+    int64_t start = time_nanoseconds();
+
+    while (true)
+    {
+        playback->clock_time = num_frames * SCREEN_FRAME_DURATION;
+        playback->clock_update_time = time_nanoseconds();
+
+        // the report of the frame stats is printed when the chart finishes
+        if (playback_update(playback))
+            break;
+
+        int64_t finish_start = time_nanoseconds();
+        glFinish();
+        frame_stats_end_frame(frame_stats, time_nanoseconds() - finish_start);
+        num_frames++;
+    }
+
+    int64_t duration = time_nanoseconds() - start;
+    printf("playback_update: %d notes, %d frames in %.3f ms, %.3f ms per frame\n",
+           num_notes,
+           num_frames,
+           time_nanoseconds_to_milliseconds(duration),
+           time_nanoseconds_to_milliseconds(duration) / num_frames);
+
+    // free everything
+    playback_free(playback);
+    frame_stats_free(frame_stats);
+    audio_track_free(audio_track);
+    scoring_free(scoring);
+    track_free(track);
+    screen_free(screen);
+    chart_free(chart);
+
+    return EXIT_SUCCESS;
+}
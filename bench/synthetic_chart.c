@@ -0,0 +1,98 @@
+#include "synthetic_chart.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "chart.h"
+
+// the number of beats in each measure of a synthetic chart, which is always in 4/4
+#define SYNTHETIC_CHART_MEASURE_BEATS 4
+
+// the first and last vox track numbers of the bt and fx lanes
+#define SYNTHETIC_CHART_FIRST_NOTE_TRACK 2
+#define SYNTHETIC_CHART_LAST_NOTE_TRACK 7
+
+void write_position(FILE *file, int subbeat)
+{
+    // write the given subbeat as a vox position, 1 based measures and beats and 0 based subbeats
+    int beat = subbeat / CHART_BEAT_SUBBEATS;
+    fprintf(file,
+            "%03d,%02d,%02d",
+            beat / SYNTHETIC_CHART_MEASURE_BEATS + 1,
+            beat % SYNTHETIC_CHART_MEASURE_BEATS + 1,
+            subbeat % CHART_BEAT_SUBBEATS);
+}
+
+bool synthetic_chart_write(const char *path, int num_notes)
+{
+    assert(num_notes >= 0 && num_notes <= SYNTHETIC_CHART_MAX_NOTES);
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        printf("synthetic_chart_write: failed to open %s\n", path);
+        return false;
+    }
+
+    // get how many measures the notes span, starting from the second measure
+    int num_lanes = SYNTHETIC_CHART_LAST_NOTE_TRACK - SYNTHETIC_CHART_FIRST_NOTE_TRACK + 1;
+    int measure_subbeats = SYNTHETIC_CHART_MEASURE_BEATS * CHART_BEAT_SUBBEATS;
+    int lane_notes = (num_notes + num_lanes - 1) / num_lanes;
+    int num_measures = (lane_notes * SYNTHETIC_CHART_NOTE_SUBBEATS + measure_subbeats - 1) / measure_subbeats;
+
+    // write the header sections
+    fprintf(file, "#FORMAT VERSION\r\n10\r\n#END\r\n\r\n");
+    fprintf(file, "#BEAT INFO\r\n001,01,00\t4\t4\r\n#END\r\n\r\n");
+    fprintf(file, "#BPM INFO\r\n001,01,00\t180.0000\t4\r\n#END\r\n\r\n");
+
+    // end two measures after the last note
+    fprintf(file, "#END POSISION\r\n");
+    write_position(file, (num_measures + 3) * measure_subbeats);
+    fprintf(file, "\r\n#END\r\n\r\n");
+
+    // write the analogs, each sweeping across the track and back once every measure
+    for (int track = 1; track <= 8; track += 7)
+    {
+        fprintf(file, "#TRACK%d\r\n", track);
+
+        for (int measure = 1; measure <= num_measures; measure++)
+        {
+            int start = measure * measure_subbeats;
+            int positions[] = { 0, 127, 0 };
+            int states[] = { 1, 0, 2 };
+
+            for (int i = 0; i < 3; i++)
+            {
+                write_position(file, start + i * CHART_BEAT_SUBBEATS);
+                fprintf(file, "\t%d\t%d\t0\t0\t1\t0\r\n", (track == 1) ? positions[i] : 127 - positions[i], states[i]);
+            }
+        }
+
+        fprintf(file, "#END\r\n\r\n");
+    }
+
+    // write the notes, round robin across the lanes so each lane gets every sixteenth
+    for (int track = SYNTHETIC_CHART_FIRST_NOTE_TRACK; track <= SYNTHETIC_CHART_LAST_NOTE_TRACK; track++)
+    {
+        fprintf(file, "#TRACK%d\r\n", track);
+
+        int lane = track - SYNTHETIC_CHART_FIRST_NOTE_TRACK;
+        for (int i = 0; i * num_lanes + lane < num_notes; i++)
+        {
+            // make every fourth note a hold that ends before the next note
+            write_position(file, measure_subbeats + i * SYNTHETIC_CHART_NOTE_SUBBEATS);
+            fprintf(file, "\t%d\t0\r\n", (i % 4 == 3) ? SYNTHETIC_CHART_NOTE_SUBBEATS / 2 : 0);
+        }
+
+        fprintf(file, "#END\r\n\r\n");
+    }
+
+    bool written = !ferror(file);
+    if (fclose(file) != 0)
+        written = false;
+
+    if (!written)
+        printf("synthetic_chart_write: failed to write %s\n", path);
+
+    return written;
+}
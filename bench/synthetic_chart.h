@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+
+// the subbeats between each note on a lane of a synthetic chart, a sixteenth note
+#define SYNTHETIC_CHART_NOTE_SUBBEATS 12
+
+// the most notes a synthetic chart can have
+// bounded by the subbeats of a chart, which are 16 bit
+#define SYNTHETIC_CHART_MAX_NOTES 30000
+
+// write a synthetic vox chart with the given number of notes to the given path
+// notes are spread across every bt and fx lane, every fourth note on each lane is a hold, and both analogs sweep every measure
+// returns whether or not the chart was written
+bool synthetic_chart_write(const char *path, int num_notes);
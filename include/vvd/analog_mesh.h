@@ -5,9 +5,9 @@
 #include "chart.h"
 
 // the size, in vertices, of a segment/slam/slam tail in an analog mesh
-#define ANALOG_MESH_SEGMENT_SIZE MESH_VERTICES_QUAD
-#define ANALOG_MESH_SLAM_SIZE MESH_VERTICES_QUAD
-#define ANALOG_MESH_SLAM_TAIL_SIZE MESH_VERTICES_QUAD
+#define ANALOG_MESH_SEGMENT_SIZE MESH_COMPACT_VERTICES_QUAD
+#define ANALOG_MESH_SLAM_SIZE MESH_COMPACT_VERTICES_QUAD
+#define ANALOG_MESH_SLAM_TAIL_SIZE MESH_COMPACT_VERTICES_QUAD
 
 // the width of a non-slam analog segment
 #define ANALOG_MESH_SEGMENT_WIDTH (TRACK_GUTTER_WIDTH * 1.1f)
@@ -24,6 +24,15 @@
 // the minimum height scale for slams in an analog mesh
 #define ANALOG_MESH_SLAM_MIN_HEIGHT_SCALE 0.5
 
+typedef struct
+{
+    // the start and end subbeats of this segment
+    uint16_t start_subbeat, end_subbeat;
+
+    // the index and number of the vertices of this segment in its meshes mesh
+    int vertices_index, num_vertices;
+} AnalogMeshSegment;
+
 typedef struct
 {
     // the chart for this mesh to get analogs from
@@ -35,18 +44,23 @@ typedef struct
 
     // the mesh for analogs in this mesh
     Mesh *mesh;
+
+    // the segments of every analog of each lane, in the order they are in mesh
+    // analogs on a lane never overlap, so both the start and end subbeats of the segments of a lane are sorted
+    int num_segments[CHART_ANALOG_LANES];
+    AnalogMeshSegment *segments[CHART_ANALOG_LANES];
 } AnalogMesh;
 
 AnalogMesh *analog_mesh_create(Chart *chart);
 void analog_mesh_free(AnalogMesh *mesh);
 
-// draw the given meshes segments that are in range of start_subbeat and end_subbeat at the given speed, with the given projection, view, and model matrices
+// draw the given meshes segments that are in range of start_subbeat and end_subbeat at the given speed, with the given view projection and model matrices
+// analogs should be drawn with additive blending
 // analog meshes scroll themselves from 0,0,0 based on the given speed and position
 // model should be used for offsetting the scrolling from 0,0,0
 // position should be the current scroll position of this mesh at 1x speed
 void analog_mesh_draw(AnalogMesh *mesh,
-                      mat4_t projection,
-                      mat4_t view,
+                      mat4_t view_projection,
                       mat4_t model,
                       double position,
                       uint16_t start_subbeat,
@@ -2,12 +2,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
-// max values
-#define CHART_STR_MAX 1024
-#define CHART_EVENTS_MAX 256
-#define CHART_NOTES_MAX 1024
-#define CHART_ANALOG_POINTS_MAX 16
+// the alignment, in bytes, of each block of values in a charts arena
+#define CHART_ARENA_ALIGNMENT 8
 
 // number of lanes per note type
 #define CHART_BT_LANES 4
@@ -127,6 +125,11 @@ typedef struct
     int num_analogs[CHART_ANALOG_LANES];
     Analog *analogs[CHART_ANALOG_LANES];
 
+    // the points of every analog of each lane of this chart, in order
+    // the points of each analog are a range of its lanes points
+    int num_analog_points[CHART_ANALOG_LANES];
+    AnalogPoint *analog_points[CHART_ANALOG_LANES];
+
     // the most consistent bpm of this chart
     // found by getting the bpm in this chart that is active for the longest duration
     double main_bpm;
@@ -139,8 +142,19 @@ typedef struct
 
     // the total number of measures in this chart
     uint16_t num_measures;
+
+    // the single allocation that holds all of this charts values that are not in cache_data
+    // sized exactly to the charts contents and freed in one call by chart_free
+    void *arena;
+
+    // the mapped cache file that this charts values point into, if it was loaded from a cache
+    // null if this chart was parsed from its source
+    void *cache_data;
+    size_t cache_size;
 } Chart;
 
+// load the chart at the given path
+// uses the charts compiled cache if there is a valid one, otherwise parses the chart and writes its cache
 Chart *chart_create(const char *path);
 void chart_free(Chart *chart);
 
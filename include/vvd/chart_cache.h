@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chart.h"
+
+// the identifier at the start of every chart cache file
+#define CHART_CACHE_MAGIC "VVDC"
+
+// the current version of the chart cache format
+// increment this whenever the layout of a cache file or any record in it changes
+#define CHART_CACHE_VERSION 3
+
+// the extension that chart caches are written with, replacing their source charts extension
+#define CHART_CACHE_EXTENSION ".vvdc"
+
+// the alignment, in bytes, of every section in a chart cache file
+#define CHART_CACHE_ALIGNMENT 8
+
+typedef struct
+{
+    // the number of points in this analog
+    uint32_t num_points;
+
+    // the index of this analogs first point in its lanes points
+    uint32_t first_point;
+} ChartCacheAnalog;
+
+typedef struct
+{
+    // the number of records in this section
+    uint32_t count;
+
+    // the offset, in bytes from the start of the cache file, of this sections first record
+    uint32_t offset;
+} ChartCacheSection;
+
+typedef struct
+{
+    // always CHART_CACHE_MAGIC, without a terminator
+    char magic[4];
+
+    // the CHART_CACHE_VERSION this cache was written with
+    uint32_t version;
+
+    // the sizes of each record type when this cache was written
+    // caches written by builds with a different struct layout are rebuilt
+    uint16_t beat_size;
+    uint16_t tempo_size;
+    uint16_t note_size;
+    uint16_t analog_point_size;
+
+    // the size, modification time, and hash of the source chart this cache was compiled from
+    uint64_t source_size;
+    int64_t source_mtime_seconds;
+    int64_t source_mtime_nanoseconds;
+    uint64_t source_hash;
+
+    // the values of the cached chart
+    double offset;
+    double main_bpm;
+    double end_time;
+    uint16_t end_subbeat;
+    uint16_t num_measures;
+    uint8_t rating;
+
+    // the offsets of each metadata string, null terminated
+    uint32_t title_offset;
+    uint32_t artist_offset;
+    uint32_t effector_offset;
+    uint32_t illustrator_offset;
+
+    // the beats and tempos of the cached chart
+    ChartCacheSection beats;
+    ChartCacheSection tempos;
+
+    // the notes of each bt and fx lane of the cached chart
+    ChartCacheSection bt_notes[CHART_BT_LANES];
+    ChartCacheSection fx_notes[CHART_FX_LANES];
+
+    // the ChartCacheAnalog records and points of each analog lane of the cached chart
+    ChartCacheSection analogs[CHART_ANALOG_LANES];
+    ChartCacheSection analog_points[CHART_ANALOG_LANES];
+} ChartCacheHeader;
+
+// set whether or not chart caches are loaded and written, enabled by default
+// disabling caches makes chart_create always parse the source chart, such as to benchmark parsing
+void chart_cache_set_enabled(bool enabled);
+
+// load the cache for the chart at the given source path
+// returns null if there is no cache, or if the cache is stale or invalid
+// the returned chart maps the cache file directly and is freed with chart_free
+Chart *chart_cache_load(const char *source_path);
+
+// compile the given chart, parsed from the given source path, to a cache file next to the source
+// failing to write the cache is not an error, the chart is just parsed again on the next load
+void chart_cache_write(Chart *chart, const char *source_path);
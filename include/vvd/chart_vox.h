@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "chart.h"
 
@@ -8,6 +9,9 @@
 // todo: test with more charts
 #define VOX_DATA_LINE_MAX_VALUES 8
 
+// the highest track number in a vox file, "TRACK[n]"
+#define VOX_TRACK_NUMBER_MAX 8
+
 typedef enum
 {
     VoxSectionNone,          //none yet or END
@@ -34,6 +38,27 @@ typedef enum
 
 typedef struct
 {
+    // the name of this section, without the leading #
+    const char *name;
+    size_t length;
+
+    // the section that this name starts
+    VoxSection section;
+} VoxSectionName;
+
+typedef struct
+{
+    // the first character of this value and the character after its last
+    // values point into the mapped chart file and are not null terminated
+    const char *start;
+    const char *end;
+} VoxValue;
+
+typedef struct
+{
+    // whether or not this parser is only counting the values of the chart to size its arena
+    bool counting;
+
     // the current section the parser is in
     VoxSection section;
 
@@ -44,7 +69,10 @@ typedef struct
     Analog *building_analogs[CHART_ANALOG_LANES];
 } VoxParsingState;
 
-void *chart_vox_parsing_state_create();
+// create a parsing state for the counting pass of a chart if counting is true, or the filling pass if not
+void *chart_vox_parsing_state_create(bool counting);
 void chart_vox_parsing_state_free(void *parsing_state);
 
-void chart_vox_parse_line(Chart *chart, void *parsing_state, char *line);
+// parse the line from line to line_end, exclusive
+// line does not need to be null terminated
+void chart_vox_parse_line(Chart *chart, void *parsing_state, const char *line, const char *line_end);
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "timing.h"
+#include "screen.h"
+
+// the number of linear sub buckets in each power of two range of a histogram
+// durations are recorded to within 1 / FRAME_STATS_SUB_BUCKETS of their value
+#define FRAME_STATS_SUB_BUCKETS 32
+
+// the number of power of two ranges above the first of a histogram
+// durations past the last range are recorded in its last bucket
+#define FRAME_STATS_MAX_SHIFT 20
+
+// the number of buckets in a histogram
+// the first two ranges share a shift of 0, so there is one more range than shifts
+#define FRAME_STATS_BUCKETS ((FRAME_STATS_MAX_SHIFT + 2) * FRAME_STATS_SUB_BUCKETS)
+
+// the number of late frames that are kept, later late frames are only counted
+#define FRAME_STATS_MAX_LATE_FRAMES 1024
+
+// the duration, in nanoseconds, between the end of two frames past which a frame is late
+// swapping waits for the next vblank, so a frame that misses its deadline takes at least one more frame duration
+// this is half way between the two, so jitter of on time frames is not counted
+#define FRAME_STATS_LATE_THRESHOLD (TIME_NANOSECONDS_PER_SECOND * 3 / (SCREEN_RATE * 2))
+
+// a histogram of durations, bucketed by microsecond with a fixed relative precision
+// each power of two range of durations is split into FRAME_STATS_SUB_BUCKETS linear buckets
+typedef struct
+{
+    // the number of durations recorded in each bucket
+    uint32_t counts[FRAME_STATS_BUCKETS];
+
+    // the number of durations recorded
+    uint32_t count;
+
+    // the shortest and longest durations recorded, in nanoseconds
+    int64_t min, max;
+} FrameStatsHistogram;
+
+// a frame that was late
+typedef struct
+{
+    // the chart time of the frame, in milliseconds
+    double chart_time;
+
+    // how long the frame took, in nanoseconds
+    int64_t duration;
+} FrameStatsLateFrame;
+
+// the durations of the frames of a song, and the frames that missed their deadline
+typedef struct
+{
+    // the histograms of the update, draw and swap durations of each frame
+    FrameStatsHistogram update;
+    FrameStatsHistogram draw;
+    FrameStatsHistogram swap;
+
+    // the histogram of the durations between the end of each frame and the next
+    FrameStatsHistogram frame;
+
+    // the update and draw durations and chart time of the current frame
+    // set by frame_stats_record and recorded by frame_stats_end_frame
+    int64_t current_update, current_draw;
+    double current_chart_time;
+
+    // the time, from time_nanoseconds, that the last frame ended at, or 0 if there has not been a frame yet
+    int64_t last_frame_end;
+
+    // the frames that were late, in the order they occured
+    // num_late_frames counts every late frame, even those past FRAME_STATS_MAX_LATE_FRAMES that were not kept
+    FrameStatsLateFrame late_frames[FRAME_STATS_MAX_LATE_FRAMES];
+    int num_late_frames;
+} FrameStats;
+
+FrameStats *frame_stats_create();
+void frame_stats_free(FrameStats *stats);
+
+// set the given durations, in nanoseconds, of updating and drawing the current frame, and the chart time it was drawn at
+void frame_stats_record(FrameStats *stats, int64_t update_duration, int64_t draw_duration, double chart_time);
+
+// finish the current frame after it was swapped, which took the given duration in nanoseconds
+void frame_stats_end_frame(FrameStats *stats, int64_t swap_duration);
+
+// get the duration, in nanoseconds, that the given percentage of durations in the given histogram are at or below
+// returns 0 if the histogram is empty
+int64_t frame_stats_percentile(FrameStatsHistogram *histogram, double percentage);
+
+// write a report of the given stats to the given file
+void frame_stats_write_report(FrameStats *stats, FILE *file);
+
+// write a report of the given stats to the file at the given path
+// returns whether or not the file was written
+bool frame_stats_write(FrameStats *stats, const char *path);
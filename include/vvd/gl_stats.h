@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+#include <GLES2/gl2.h>
+
+// the number of gl calls made during a frame, by kind
+// only counted when built with GL_STATS defined, otherwise every count is always 0
+typedef struct
+{
+    // the number of draw calls, and the number of vertices and indices they submitted
+    // array draws submit vertices and indexed draws submit indices, a quad is 4 vertices but 6 indices
+    int draw_calls;
+    int vertices;
+    int indices;
+
+    // the number of uniform uploads
+    int uniform_uploads;
+
+    // the number of buffer uploads, and the total bytes they uploaded
+    int buffer_uploads;
+    long buffer_upload_bytes;
+
+    // the number of program switches and blend changes that reached gl
+    int program_switches;
+    int blend_changes;
+} GLStats;
+
+// count a call of each kind
+void gl_stats_count_draw(GLsizei vertices);
+void gl_stats_count_indexed_draw(GLsizei indices);
+void gl_stats_count_uniform();
+void gl_stats_count_buffer_upload(GLsizeiptr size);
+void gl_stats_count_program_switch();
+void gl_stats_count_blend_change();
+
+// finish the current frame, starting new stats for the next one
+// if a csv file is set, the stats of the finished frame are written to it
+void gl_stats_end_frame();
+
+// get the stats of the last finished frame
+GLStats gl_stats_last_frame();
+
+// set the file to write the stats of each finished frame to as csv, or NULL to stop
+// the csv header is written to the given file immediately
+void gl_stats_set_csv(FILE *file);
+
+// instrument the gl entry points used by the renderer in files that include this header
+// each call is counted, then passed to gl unchanged
+#ifdef GL_STATS
+#define glDrawArrays(mode, first, count) (gl_stats_count_draw(count), glDrawArrays(mode, first, count))
+#define glDrawElements(mode, count, type, indices) (gl_stats_count_indexed_draw(count), glDrawElements(mode, count, type, indices))
+#define glUniform1i(...) (gl_stats_count_uniform(), glUniform1i(__VA_ARGS__))
+#define glUniform1f(...) (gl_stats_count_uniform(), glUniform1f(__VA_ARGS__))
+#define glUniformMatrix4fv(...) (gl_stats_count_uniform(), glUniformMatrix4fv(__VA_ARGS__))
+#define glBufferData(target, size, data, usage) (gl_stats_count_buffer_upload(size), glBufferData(target, size, data, usage))
+#define glBufferSubData(target, offset, size, data) (gl_stats_count_buffer_upload(size), glBufferSubData(target, offset, size, data))
+#define glUseProgram(program) (gl_stats_count_program_switch(), glUseProgram(program))
+#define glBlendFunc(source, destination) (gl_stats_count_blend_change(), glBlendFunc(source, destination))
+#endif
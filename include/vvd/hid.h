@@ -3,6 +3,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// the maximum size of a report, including the report id
+#define HID_MAX_BUFFER 65
+
 typedef struct
 {
     uint8_t report_id;
@@ -64,3 +67,14 @@ void hid_device_set_light(HIDDevice *device, int index, bool on);
 
 // update the given device and process its pending requests
 void hid_device_update(HIDDevice *device);
+
+// read the next unread report of the given device into buffer, reading at most size bytes
+// returns the size of the report read, 0 if there are no unread reports, or -1 if reading failed, such as when the device was unplugged
+int hid_device_read_report(HIDDevice *device, char *buffer, int size);
+
+// get the value of the axis at the given index from the given report of the given device
+// returns a float between 0 (not turned) and 1 (fully turned)
+float hid_device_report_axis(HIDDevice *device, const char *report, int index);
+
+// get whether or not the button at the given index is pressed in the given report of the given device
+bool hid_device_report_button(HIDDevice *device, const char *report, int index);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "hid.h"
+#include "hid_config.h"
+#include "chart.h"
+
+// the number of events an input can hold before they are read
+// must be a power of two
+#define INPUT_MAX_EVENTS 256
+
+// how long, in milliseconds, the input thread waits for a report before checking if it should stop
+#define INPUT_POLL_TIMEOUT 100
+
+typedef enum
+{
+    // the bt/fx button for lane changed to pressed
+    InputEventBt,
+    InputEventFx,
+
+    // the start button changed to pressed
+    InputEventStart,
+
+    // the knob for lane changed to value
+    InputEventKnob,
+} InputEventType;
+
+typedef struct
+{
+    // the time this event occured at, from time_nanoseconds
+    int64_t time;
+
+    // the value of the knob, if this is a knob event
+    float value;
+
+    // the InputEventType of this event
+    uint8_t type;
+
+    // the lane of this event, if it is a bt, fx or knob event
+    uint8_t lane;
+
+    // whether or not the button is pressed, if this is a button event
+    bool pressed;
+} InputEvent;
+
+// reads the reports of an hid device on its own thread and turns them into timestamped events
+// while an input exists for a device, hid_device_update must not be used to get inputs from it
+typedef struct
+{
+    // the device to read reports from
+    HIDDevice *device;
+
+    // the config to map the buttons and axes of device with
+    HIDConfig config;
+
+    // the thread reading reports from device
+    pthread_t thread;
+
+    // whether or not thread should keep running
+    atomic_bool running;
+
+    // whether or not device has been disconnected, after which thread stops and no more events are written
+    atomic_bool disconnected;
+
+    // the events that have not yet been read, as a ring buffer
+    // only the input thread writes events and only the reading thread reads them
+    InputEvent events[INPUT_MAX_EVENTS];
+
+    // the total number of events written to and read from events
+    // the index of an event in events is its number modulo INPUT_MAX_EVENTS
+    atomic_uint events_written;
+    atomic_uint events_read;
+
+    // the number of events that were lost because events was full
+    atomic_uint events_dropped;
+
+    // the last states of the buttons and axes of device, only used by the input thread
+    bool bt_states[CHART_BT_LANES];
+    bool fx_states[CHART_FX_LANES];
+    bool start_state;
+    float knob_values[CHART_ANALOG_LANES];
+} Input;
+
+// create an input reading the given device with the given config, and start its thread
+Input *input_create(HIDDevice *device, HIDConfig config);
+
+// stop the thread of and free the given input
+void input_free(Input *input);
+
+// get whether or not the device of the given input was disconnected
+// the events written before it was disconnected can still be read
+bool input_disconnected(Input *input);
+
+// read the next unread event of the given input into event
+// returns whether or not there was an unread event
+bool input_read_event(Input *input, InputEvent *event);
@@ -8,7 +8,7 @@
 #define JUDGEMENT_CRITICAL_WINDOW 2 * SCREEN_FRAME_DURATION
 #define JUDGEMENT_NEAR_WINDOW 4 * SCREEN_FRAME_DURATION
 #define JUDGEMENT_ERROR_WINDOW 8 * SCREEN_FRAME_DURATION
-#define JUDGEMENT_ANALOG_SLAM_WINDOW JUDGEMENT_CRITICAL_WINDOW + JUDGEMENT_NEAR_WINDOW
+#define JUDGEMENT_ANALOG_SLAM_WINDOW (JUDGEMENT_CRITICAL_WINDOW + JUDGEMENT_NEAR_WINDOW)
 
 // timing window for the start of holds
 // only applies to before (-)
@@ -32,5 +32,6 @@ typedef struct
 MeasureBarMesh *measure_bar_mesh_create(Chart *chart);
 void measure_bar_mesh_free(MeasureBarMesh *mesh);
 
-// draw the given meshes measure bars that are in range of start_subbeat and end_subbeat as speed, with the given projection, view, and model matrices
-void measure_bar_mesh_draw(MeasureBarMesh *mesh, mat4_t projection, mat4_t view, mat4_t model, uint16_t start_subbeat, uint16_t end_subbeat, double speed);
+// draw the given meshes measure bars that are in range of start_subbeat and end_subbeat as speed, with the given view projection and model matrices
+// measure bars should be drawn with normal blending
+void measure_bar_mesh_draw(MeasureBarMesh *mesh, mat4_t view_projection, mat4_t model, uint16_t start_subbeat, uint16_t end_subbeat, double speed);
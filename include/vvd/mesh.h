@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <GLES2/gl2.h>
 #include <arkanis/math_3d.h>
 
@@ -13,27 +14,98 @@
 #define MESH_VERTICES_TRIANGLE 3
 #define MESH_VERTICES_QUAD MESH_VERTICES_TRIANGLE * 2
 
+// the number of vertices and indices of a quad in a compact mesh
+#define MESH_COMPACT_VERTICES_QUAD 4
+#define MESH_COMPACT_INDICES_QUAD 6
+
+// the number of vertices in each chunk of a compact mesh, as many as GL_UNSIGNED_SHORT indices can reach
+// larger compact meshes are drawn one chunk at a time, with the vertex attributes pointed at the start of each chunk
+#define MESH_COMPACT_CHUNK_VERTICES 65536
+
+// the range of the x positions and y offsets of compact vertices, positions outside of -range and +range are clamped to it
+#define MESH_COMPACT_POSITION_RANGE 2.0f
+
+typedef enum
+{
+    // each vertex is MESH_VERTEX_VALUES floats, and each quad is MESH_VERTICES_QUAD vertices
+    MeshLayoutFloat,
+
+    // each vertex is a MeshCompactVertex, and each quad is MESH_COMPACT_VERTICES_QUAD vertices drawn with a shared index buffer
+    MeshLayoutCompact,
+} MeshLayout;
+
+// a vertex of a compact mesh, for geometry that is laid out along the track
+// z is always 0, anything that needs raising is raised by its model matrix
 typedef struct
 {
+    // the x position and y offset of this vertex, normalized to MESH_COMPACT_POSITION_RANGE
+    GLshort x, y;
+
+    // the position of this vertex along the track at 1x speed
+    // the vertex shader scales this by the current speed before adding y
+    GLfloat track_position;
+} MeshCompactVertex;
+
+typedef struct
+{
+    // the MeshLayout of this meshes vertices
+    MeshLayout layout;
+
     // the id of this meshes vertex buffer
     GLuint vertex_buffer_id;
 
     // the maximum number of vertices in this meshes vertex buffer
     GLuint max_vertices;
 
+    // the usage hint of this meshes vertex buffer
+    GLenum usage;
+
+    // a cpu side copy of the vertex buffer that vertices are set on while staging, otherwise NULL
+    void *staging_vertices;
+
     // the program for this meshes geometry and material
     Program *program;
     GLuint attribute_vertex_position_id;
+
+    // the track position attribute, only used by compact meshes
+    GLuint attribute_vertex_track_position_id;
+
+    // an extra attribute of tightly packed floats from another buffer, with a value for each vertex of this mesh
+    // only used if has_extra_attribute, set with mesh_set_extra_attribute
+    bool has_extra_attribute;
+    GLuint attribute_extra_id;
+    GLuint extra_buffer_id;
+    GLint extra_size;
 } Mesh;
 
 // create a new mesh of the given type with the given number of maximum vertices using the given program for its geometry and material
 // the given programs vertex shader must have a vec3 vertexPosition attribute
 Mesh *mesh_create(int max_vertices, Program *program, GLenum usage);
+
+// create a new compact mesh with the given number of maximum vertices, which must be a multiple of MESH_COMPACT_VERTICES_QUAD
+// compact meshes can only hold quads, set with mesh_set_compact_quad_edges
+// the given programs vertex shader must have a vec2 vertexPosition attribute, a float vertexTrackPosition attribute,
+// and a float positionRange uniform to scale vertexPosition by
+Mesh *mesh_create_compact(int max_vertices, Program *program, GLenum usage);
+
 void mesh_free(Mesh *mesh);
 
+// set the given attribute of the given meshes program to be passed the given size of floats per vertex from the given buffer when drawing
+// the buffer must have values for every vertex of the mesh, and is pointed at the same vertices as the mesh when drawing each chunk
+void mesh_set_extra_attribute(Mesh *mesh, GLuint attribute_id, GLuint buffer_id, GLint size);
+
+// start staging the vertices of the given mesh
+// while staging, mesh_set_vertices and its helpers write to a cpu side copy of the vertex buffer instead of gl,
+// so building a mesh from many quads only uploads once, in mesh_upload_vertices
+// vertices that are not set while staging are zeroed
+void mesh_stage_vertices(Mesh *mesh);
+
+// upload the vertices set since mesh_stage_vertices to the given meshes vertex buffer, and stop staging
+void mesh_upload_vertices(Mesh *mesh);
+
 // set the given meshes vertices to the given vertices, offset by the given vertice index
-// vertices_size should be sizeof(vertices)
-void mesh_set_vertices(Mesh *mesh, int index, const GLfloat *vertices, size_t vertices_size);
+// vertices must be in the layout of the given mesh, and vertices_size should be sizeof(vertices)
+void mesh_set_vertices(Mesh *mesh, int index, const void *vertices, size_t vertices_size);
 
 // a helper method for calling mesh_set_vertices with a quad generated from the given width and height and position
 // origin point is bottom-left
@@ -45,14 +117,20 @@ void mesh_set_vertices_quad(Mesh *mesh, int index, GLfloat width, GLfloat height
 // origin and position are the same as mesh_set_vertices_quad
 void mesh_set_vertices_quad_edges(Mesh *mesh, int index, GLfloat width, vec3_t start_position, vec3_t end_position);
 
+// a helper method for calling mesh_set_vertices on a compact mesh with a quad generated from the given width, drawn from the given start to end positions
+// the x and y of each position are the x position and y offset of the edge, and z is its position along the track at 1x speed
+// origin is the same as mesh_set_vertices_quad
+void mesh_set_compact_quad_edges(Mesh *mesh, int index, GLfloat width, vec3_t start_position, vec3_t end_position);
+
 // bind the given mesh so it can draw vertices
 // this function only binds the given meshes vertex buffer, the program needs to be used manually
 void mesh_draw_start(Mesh *mesh);
 
-// unbind the given mesh after caling mesh_draw_start
+// finish drawing the given mesh after caling mesh_draw_start
 void mesh_draw_end(Mesh *mesh);
 
 // draw the vertices of the given mesh at the given index of the given size
+// for compact meshes index and size must be multiples of MESH_COMPACT_VERTICES_QUAD
 // must call mesh_draw_start first
 void mesh_draw_vertices(Mesh *mesh, int index, size_t size);
 
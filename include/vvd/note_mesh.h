@@ -7,8 +7,8 @@
 #include "chart.h"
 
 // the size, in vertices, of a chip/hold in a note mesh
-#define NOTE_MESH_CHIP_SIZE MESH_VERTICES_QUAD
-#define NOTE_MESH_HOLD_SIZE MESH_VERTICES_QUAD
+#define NOTE_MESH_CHIP_SIZE MESH_COMPACT_VERTICES_QUAD
+#define NOTE_MESH_HOLD_SIZE MESH_COMPACT_VERTICES_QUAD
 
 // the draw height of a chip note
 #define NOTE_MESH_CHIP_HEIGHT 0.075f
@@ -41,15 +41,33 @@ typedef struct
 
     // the programs and meshes for chips and holds of this mesh
     Program *chips_program, *holds_program;
-    GLuint uniform_chips_speed_id, uniform_chips_position_id;
-    GLuint uniform_holds_speed_id, uniform_holds_state_id;
+    GLuint uniform_chips_speed_id;
+    GLuint uniform_holds_speed_id, attribute_holds_state_id;
     Mesh *chips_mesh, *holds_mesh;
 
-    // the draw positions at 1x speed of each chip in notes
-    float **chip_positions;
+    // the buffer of the HoldState of each vertex in holds_mesh
+    // only the vertices of the current holds are ever not HoldStateDefault
+    GLuint hold_states_buffer_id;
 
-    // whether or not each chip from notes is removed
-    bool **chips_removed;
+    // the number of chips in notes, and the start subbeat of each of them in the order they are in chips_mesh
+    // chips_mesh holds every chip sorted by start subbeat, so the chips in a range of subbeats are contiguous
+    int num_chips;
+    uint16_t *chip_subbeats;
+
+    // the index of each chip from notes in chips_mesh, in chips
+    int **chip_indexes;
+
+    // the number of holds in notes, and the start subbeat of each of them in the order they are in holds_mesh
+    // holds_mesh holds every hold sorted by start subbeat, like chips_mesh
+    int num_holds;
+    uint16_t *hold_start_subbeats;
+
+    // the latest end subbeat of each hold in holds_mesh and every hold before it
+    // as these only ever increase, the first hold that could still be in range can be binary searched
+    uint16_t *hold_max_end_subbeats;
+
+    // the index of each hold from notes in holds_mesh, in holds
+    int **hold_indexes;
 
     // the indexes of the current hold of each lane of this mesh, if any
     int *current_hold_indexes;
@@ -68,6 +86,7 @@ NoteMesh *note_mesh_create(const char *type_name,
 void note_mesh_free(NoteMesh *mesh);
 
 // remove the vertices for the chip at the given lane and index from the given mesh
+// the chip is collapsed in place, so it stays in the same draw as every other chip
 void note_mesh_remove_chip(NoteMesh *mesh, int lane, int index);
 
 // set the given note meshes hold that takes on the current hold state
@@ -77,8 +96,10 @@ void note_mesh_set_current_hold(NoteMesh *mesh, int lane, int index);
 // this state is stored and applies between changes of the current hold
 void note_mesh_set_current_hold_state(NoteMesh *mesh, int lane, HoldState state);
 
-// draw the given meshes chips that are in range of start_subbeat and end_subbeat as speed, with the given projection, view, and model matrices
-void note_mesh_draw_chips(NoteMesh *mesh, mat4_t projection, mat4_t view, mat4_t model, uint16_t start_subbeat, uint16_t end_subbeat, double speed);
+// draw the given meshes chips that are in range of start_subbeat and end_subbeat as speed, with the given view projection and model matrices
+// chips should be drawn with normal blending
+void note_mesh_draw_chips(NoteMesh *mesh, mat4_t view_projection, mat4_t model, uint16_t start_subbeat, uint16_t end_subbeat, double speed);
 
-// draw the given meshes holds that are in range of start_subbeat and end_subbeat as speed, with the given projection, view, and model matrices
-void note_mesh_draw_holds(NoteMesh *mesh, mat4_t projection, mat4_t view, mat4_t model, uint16_t start_subbeat, uint16_t end_subbeat, double speed);
+// draw the given meshes holds that are in range of start_subbeat and end_subbeat as speed, with the given view projection and model matrices
+// holds should be drawn with additive blending
+void note_mesh_draw_holds(NoteMesh *mesh, mat4_t view_projection, mat4_t model, uint16_t start_subbeat, uint16_t end_subbeat, double speed);
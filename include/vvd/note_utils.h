@@ -8,8 +8,15 @@
 uint16_t note_time_at_beat_to_subbeat(Beat *note_beat, uint16_t measure, uint8_t beat, uint8_t subbeat);
 
 // calculate the subbeat of a note in the given chart at the given timing
+// binary searches the given charts beats for the beat of the given measure
 uint16_t note_time_to_subbeat(Chart *chart, uint16_t measure, uint8_t beat, uint8_t subbeat);
 
+// get the index of the tempo in the given charts tempos that is active at the given subbeat or time
+// a charts tempos are sorted by both subbeat and time, so these binary search them
+// returns 0 if the given subbeat or time is before the first tempo
+int tempo_index_at_subbeat(Chart *chart, double subbeat);
+int tempo_index_at_time(Chart *chart, double time);
+
 // calculate the duration in milliseconds of a given number of subbeats at the given tempo
 double subbeats_at_tempo_to_duration(Tempo *tempo, uint16_t subbeats);
 
@@ -17,5 +24,9 @@ double subbeats_at_tempo_to_duration(Tempo *tempo, uint16_t subbeats);
 // subbeat is adjusted to be relative to tempos subbeat (subbeat - tempo->subbeat)
 double subbeat_at_tempo_to_time(Tempo *tempo, uint16_t subbeat);
 
+// calculate the time in milliseconds of a given subbeat in the given chart
+// accounts for every tempo change before the given subbeat
+double subbeat_to_time(Chart *chart, uint16_t subbeat);
+
 // calculate the subbeat of a given time in milliseconds at the tempo in the given charts tempos at tempo_index
 double time_to_subbeat(Chart *chart, int tempo_index, double time);
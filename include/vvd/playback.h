@@ -4,12 +4,21 @@
 #include "audio_track.h"
 #include "track.h"
 #include "scoring.h"
+#include "timeline.h"
+#include "input.h"
+#include "frame_stats.h"
+#include "replay.h"
 
-// the size in subbeats of a tick
-#define PLAYBACK_TICK_SIZE 12
+// the portion of the difference between the audio time and the clock time that is corrected each time the audio position updates
+#define PLAYBACK_CLOCK_GAIN 0.1
 
-// if the current tempo is >= this value, then the tick size should double, halving the tick rate
-#define PLAYBACK_HALF_TICK_RATE_BPM 256
+// the most, in milliseconds, that the clock can be corrected by each time the audio position updates
+// keeps corrections small enough that scrolling never visibly jumps
+#define PLAYBACK_CLOCK_MAX_CORRECTION 1.0
+
+// if the audio is ahead of the clock by at least this many milliseconds, the clock snaps forward to the audio time instead of correcting
+// if the audio is this far behind, the clock is held until the audio catches up, as chart time must never move backwards
+#define PLAYBACK_CLOCK_SNAP_THRESHOLD 100.0
 
 typedef struct
 {
@@ -25,22 +34,72 @@ typedef struct
     // the scoring for this playback to use
     Scoring *scoring;
 
+    // the input to read button events from, if any
+    Input *input;
+
+    // the stats to record the update and draw durations of each frame in, if any
+    FrameStats *frame_stats;
+
+    // the replay to record every judged button and knob event into, if any
+    Replay *recording;
+
+    // the replay to judge events from instead of input, if any
+    Replay *replay;
+
+    // the index of the next event in replay to be judged
+    int replay_index;
+
     // the speed this playback is currently scrolling at
     double speed;
 
     // whether or not this playback has begun playing
-    // set to true after the current time is at or passed start_time in playback_update
+    // set to true after the clock reaches the start of the audio in playback_update
     bool started;
 
-    // the time, in milliseconds, that this playback should begin playing at
-    double start_time;
+    // whether or not this playback has reached the end of its chart
+    bool finished;
+
+    // the offset, in milliseconds, of the audio from the chart
+    // the audio time for a chart time is the chart time plus offset
+    double offset;
+
+    // the clock for the current time in the chart, in milliseconds
+    // clock_time was the chart time at clock_update_time, from time_nanoseconds, and the clock runs from there
+    // after the audio starts the clock is disciplined by the audio position, so it never drifts from the audio
+    double clock_time;
+    int64_t clock_update_time;
+
+    // whether or not the clock is held at clock_time until the audio position catches up to it
+    // set when the audio falls far behind the clock, such as from the latency of starting it or a stall
+    bool clock_held;
+
+    // the last audio position, in milliseconds, used to correct the clock
+    // the audio position only updates every few frames, so the clock is only corrected when it changes
+    double last_audio_position;
 
-    // the last tick this playback was updated at
-    int last_tick;
+    // the timeline of chart
+    Timeline *timeline;
+
+    // the index of the next event in timeline to be processed
+    int timeline_index;
 
     // the index of last tempo that this playback reached in charts tempos
     int tempo_index;
 
+    // the chart time of the last call to playback_update
+    // used to reset the note and analog cursors if time moves backwards
+    double last_update_time;
+
+    // the indexes of the first note on each lane that has not yet passed
+    // notes only pass as time increases, so these only move forwards until reset
+    int bt_note_cursors[CHART_BT_LANES];
+    int fx_note_cursors[CHART_FX_LANES];
+
+    // the index of the analog, and the start point within it, of the first segment on each lane that has not yet passed
+    // like the note cursors these only move forwards until reset
+    int analog_cursors[CHART_ANALOG_LANES];
+    int analog_point_cursors[CHART_ANALOG_LANES];
+
     // the indexes of the currents notes and analogs from the last call to playback_update
     int current_bt_notes[CHART_BT_LANES];
     int current_fx_notes[CHART_FX_LANES];
@@ -54,6 +113,27 @@ typedef struct
 Playback *playback_create(Chart *chart, AudioTrack *audio_track, Track *track, Scoring *scoring);
 void playback_free(Playback *playback);
 
+// set the input for the given playback to read button events from
+// the events are judged at the times they occured rather than when playback_update is called
+void playback_set_input(Playback *playback, Input *input);
+
+// set the replay for the given playback to record every button and knob event it judges into, with the chart time it was judged at
+// the caller writes the replay with replay_write once playback is finished
+void playback_set_recording(Playback *playback, Replay *recording);
+
+// set the replay for the given playback to judge events from, each at the exact chart time it was recorded at
+// while a replay is set, events from the playbacks input are ignored
+void playback_set_replay(Playback *playback, Replay *replay);
+
+// set the frame stats for the given playback to record the update and draw durations of each frame in
+// the caller must still call frame_stats_end_frame with the duration of screen_update after each frame
+// the report of the stats is printed when playback finishes
+void playback_set_frame_stats(Playback *playback, FrameStats *frame_stats);
+
+// set the offset, in milliseconds, of the audio from the chart for the given playback
+// defaults to the offset of the playbacks chart
+void playback_set_offset(Playback *playback, double offset);
+
 // set the given playbacks scroll speed
 void playback_set_speed(Playback *playback, double speed);
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// the maximum number of phases that can be recorded, phases past this are not recorded
+#define PROFILE_MAX_PHASES 64
+
+// the maximum length of the name of a phase, including the terminator
+#define PROFILE_NAME_SIZE 64
+
+// the maximum depth phases can be nested to
+#define PROFILE_MAX_DEPTH 8
+
+// a named span of work, such as loading a chart or compiling a program
+typedef struct
+{
+    // the name of this phase
+    char name[PROFILE_NAME_SIZE];
+
+    // the number of phases this phase is nested within
+    int depth;
+
+    // the wall and process cpu times, in nanoseconds, that this phase started at
+    int64_t start_wall_time;
+    int64_t start_cpu_time;
+
+    // the resident set size, in bytes, when this phase started
+    long start_rss;
+
+    // the wall and process cpu time, in nanoseconds, that this phase took
+    // only set once this phase has ended
+    int64_t wall_time;
+    int64_t cpu_time;
+
+    // the change in resident set size, in bytes, over this phase
+    // only set once this phase has ended
+    long rss_delta;
+
+    // whether or not this phase has ended
+    bool ended;
+} ProfilePhase;
+
+// start recording a phase with the given name, nested within any phases that have started but not ended
+// returns the phase to pass to profile_end, or -1 if there is no room to record it
+int profile_begin(const char *name);
+
+// stop recording the given phase from profile_begin
+// phases must end in the reverse order they began
+void profile_end(int phase);
+
+// write a report of every recorded phase, in the order they began, to the given file
+void profile_write_report(FILE *file);
+
+// forget every recorded phase
+void profile_reset();
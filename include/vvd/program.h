@@ -1,27 +1,51 @@
 #pragma once
 
+#include <stdint.h>
 #include <stdbool.h>
 #include <GLES2/gl2.h>
 #include <arkanis/math_3d.h>
 
+// the maximum number of distinct programs that can exist at once
+#define PROGRAM_MAX_PROGRAMS 32
+
 typedef struct
 {
     GLuint id;
+
+    // the shaders this program was linked from
+    // both are 0 if this program was loaded from its cached binary instead
     GLuint vertex_id, fragment_id;
 
-    // whether or not this programs vertex shader takes projection/view/model matrices
-    bool accepts_pvm_matrices;
+    // the source paths this program was created with
+    char *vertex_source_path, *fragment_source_path;
+
+    // the number of program_create calls that returned this program without a matching program_free
+    int references;
+
+    // whether or not this programs vertex shader takes a model view projection matrix
+    bool accepts_mvp;
 
-    // uniforms for the projection, view, and model matrices
-    // only used if accepts_pvm_matrices is true
-    GLuint uniform_projection_id;
-    GLuint uniform_view_id;
-    GLuint uniform_model_id;
+    // uniform for the model view projection matrix
+    // only used if accepts_mvp is true
+    // signed, as gl gives -1 for a uniform that was not found
+    GLint uniform_mvp_id;
+
+    // the last model view projection matrix set on this program, if mvp_set is true
+    // used to skip setting the same matrix again
+    bool mvp_set;
+    mat4_t mvp;
+
+    // the bits of the vertex attributes of this program that were found with program_get_attribute_id
+    uint32_t attributes;
 } Program;
 
 // create a shader program from the given vertex and fragment source paths
-// accepts_pvm_matrices should be true if the vertex shader takes projection, view, and model matrices
-Program *program_create(const char *vertex_source_path, const char *fragment_source_path, bool accepts_pvm_matrices);
+// accepts_mvp should be true if the vertex shader takes a model view projection matrix, as a mat4 mvp uniform
+// programs are shared, so creating a program with the same source paths as an existing one returns the existing one
+// where the driver supports it, linked programs are cached to disk so later runs skip compiling them
+Program *program_create(const char *vertex_source_path, const char *fragment_source_path, bool accepts_mvp);
+
+// release a program from program_create, deleting it once nothing uses it
 void program_free(Program *program);
 
 // get the id of a uniform in the given programs vertex shader
@@ -30,9 +54,12 @@ GLuint program_get_uniform_id(Program *program, const GLchar *name);
 // get the id of an attribute in the given programs vertex shader
 GLuint program_get_attribute_id(Program *program, const GLchar *name);
 
-// call glUseProgram with the given program
+// use the given program, disabling any vertex attributes it does not use
+// every attribute the given program uses must have been found with program_get_attribute_id
 void program_use(Program *program);
 
-// set the projection, view, and model matrices of the given program
-// exits if program->accepts_pvm_matrices is false
-void program_set_matrices(Program *program, mat4_t projection, mat4_t view, mat4_t model);
+// set the model view projection matrix of the given program
+// does nothing if the given matrix is the same as the last one set on the given program
+// the given program must be in use
+// exits if program->accepts_mvp is false
+void program_set_mvp(Program *program, mat4_t mvp);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <GLES2/gl2.h>
+
+// the identifier at the start of every program cache file
+#define PROGRAM_CACHE_MAGIC "VVDP"
+
+// the current version of the program cache format
+// increment this whenever the layout of a cache file changes
+#define PROGRAM_CACHE_VERSION 1
+
+// the directory, relative to the executable, that program caches are written to
+#define PROGRAM_CACHE_DIRECTORY "shader_cache"
+
+typedef struct
+{
+    // always PROGRAM_CACHE_MAGIC, without a terminator
+    char magic[4];
+
+    // the PROGRAM_CACHE_VERSION this cache was written with
+    uint32_t version;
+
+    // the hash of the sources and driver this program was linked from
+    uint64_t source_hash;
+
+    // the format and size of the program binary following this header
+    uint32_t binary_format;
+    uint32_t binary_size;
+} ProgramCacheHeader;
+
+// get the hash of a program linked from the given sources by the current driver
+uint64_t program_cache_hash(const char *vertex_source, const char *fragment_source);
+
+// try to load the cached binary of the program with the given source paths and hash into the given program
+// returns whether or not the given program was loaded and linked, if not it must be compiled instead
+// always returns false if the driver does not support GL_OES_get_program_binary
+bool program_cache_load(GLuint program, const char *vertex_source_path, const char *fragment_source_path, uint64_t hash);
+
+// write the binary of the given linked program with the given source paths and hash to its cache file
+// does nothing if the driver does not support GL_OES_get_program_binary
+void program_cache_write(GLuint program, const char *vertex_source_path, const char *fragment_source_path, uint64_t hash);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <GLES2/gl2.h>
+
+#include "program.h"
+
+// the maximum number of commands a render queue can hold in one frame
+#define RENDER_QUEUE_MAX_COMMANDS 64
+
+typedef enum
+{
+    // source alpha over the destination
+    RenderBlendNormal,
+
+    // source alpha added onto the destination
+    RenderBlendAdditive,
+} RenderBlend;
+
+// draw a command, with the context and data it was added with
+// the blending of the command is already set when this is called
+typedef void (*RenderDrawFunction)(void *context, void *data);
+
+typedef struct
+{
+    // the key this command is sorted by, from pass, blend, program, and buffer
+    uint64_t key;
+
+    // the order this command was added in, so commands with equal keys keep their order
+    int order;
+
+    // the blending to draw this command with
+    RenderBlend blend;
+
+    // the function to draw this command with, and what to pass to it
+    RenderDrawFunction draw;
+    void *context;
+    void *data;
+} RenderCommand;
+
+// a list of draw commands that are sorted to group state changes before they are drawn
+typedef struct
+{
+    int num_commands;
+    RenderCommand commands[RENDER_QUEUE_MAX_COMMANDS];
+} RenderQueue;
+
+RenderQueue *render_queue_create();
+void render_queue_free(RenderQueue *queue);
+
+// remove all the commands of the given queue
+void render_queue_clear(RenderQueue *queue);
+
+// add a command drawing with the given program and vertex buffer to the given queue
+// commands are drawn in order of pass, so passes keep any order that blending depends on
+// within a pass commands are grouped by blend, then program, then buffer
+void render_queue_add(RenderQueue *queue,
+                      uint8_t pass,
+                      RenderBlend blend,
+                      Program *program,
+                      GLuint buffer_id,
+                      RenderDrawFunction draw,
+                      void *context,
+                      void *data);
+
+// sort and draw all the commands of the given queue, then clear it
+void render_queue_submit(RenderQueue *queue);
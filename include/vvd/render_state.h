@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <GLES2/gl2.h>
+
+// the number of vertex attributes whose state is tracked
+// attributes at or above this index are always passed straight to gl
+#define RENDER_STATE_MAX_ATTRIBUTES 16
+
+// the number of gl state changes that were requested during a frame
+typedef struct
+{
+    // the number of changes that were passed to gl
+    int changes;
+
+    // the number of changes that were skipped as they would not have changed anything
+    int saved;
+} RenderStateStats;
+
+// the format of a vertex attributes pointer
+typedef struct
+{
+    GLuint buffer_id;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    GLsizeiptr offset;
+} RenderStateAttribute;
+
+// a shadow copy of the gl state that is changed while drawing
+// gl state is global to the context, so there is only one of these, owned by render_state.c
+typedef struct
+{
+    // whether or not each value below is known, false values are always passed to gl
+    bool program_known, blend_known, buffer_known, index_buffer_known;
+
+    // the program in use
+    GLuint program_id;
+
+    // the source and destination blend factors
+    GLenum blend_source, blend_destination;
+
+    // the buffers bound to GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER
+    GLuint buffer_id;
+    GLuint index_buffer_id;
+
+    // the bits of the attributes that are enabled, and of the attributes whose pointers are known
+    uint32_t attributes_enabled;
+    uint32_t attributes_known;
+
+    // the pointer of each attribute
+    RenderStateAttribute attributes[RENDER_STATE_MAX_ATTRIBUTES];
+
+    // the stats of the current frame
+    RenderStateStats stats;
+
+    // the stats of the last finished frame
+    RenderStateStats last_stats;
+} RenderState;
+
+// forget all the tracked state, so every following change is passed to gl
+// must be called whenever gl state is changed without going through render_state, e.g. after creating a context
+void render_state_reset();
+
+// call glUseProgram with the given program id, if it is not already in use
+void render_state_use_program(GLuint program_id);
+
+// call glBlendFunc with the given factors, if they are not already set
+void render_state_set_blend(GLenum source, GLenum destination);
+
+// bind the given buffer to GL_ARRAY_BUFFER, if it is not already bound
+void render_state_bind_buffer(GLuint buffer_id);
+
+// bind the given buffer to GL_ELEMENT_ARRAY_BUFFER, if it is not already bound
+void render_state_bind_index_buffer(GLuint buffer_id);
+
+// enable the given vertex attribute, and point it at tightly packed floats from the start of the given buffer
+// the enable and pointer are only passed to gl if they differ from the current state
+void render_state_set_attribute(GLuint attribute_id, GLuint buffer_id, GLint size);
+
+// enable the given vertex attribute, and point it at the given format within the given buffer
+// the enable and pointer are only passed to gl if they differ from the current state
+void render_state_set_attribute_format(GLuint attribute_id, RenderStateAttribute attribute);
+
+// disable the given vertex attribute, if it is enabled
+void render_state_disable_attribute(GLuint attribute_id);
+
+// disable every enabled vertex attribute that is not in the given bits
+void render_state_limit_attributes(uint32_t attributes);
+
+// forget the given program or buffer, as it is being deleted and its id may be reused
+void render_state_forget_program(GLuint program_id);
+void render_state_forget_buffer(GLuint buffer_id);
+
+// finish the current frame, starting new stats for the next one
+void render_state_end_frame();
+
+// get the stats of the last finished frame
+RenderStateStats render_state_last_frame_stats();
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "input.h"
+
+// the identifier at the start of every replay file
+#define REPLAY_MAGIC "VVDR"
+
+// the current version of the replay format
+// increment this whenever the layout of the header or ReplayEvent changes
+#define REPLAY_VERSION 2
+
+// the number of events a recording replay is first allocated for, it grows as needed
+#define REPLAY_INITIAL_EVENTS 1024
+
+// an input that reached playback, as it is stored in a replay file
+typedef struct
+{
+    // the chart time, in milliseconds, that this event was judged at
+    // kept as a double so replayed events are judged at exactly the same time
+    double time;
+
+    // the chart time, in milliseconds, that the timeline and current notes had been updated to when this event was judged
+    // this is after time when the event was read after playback had already passed it,
+    // so replaying brings the timeline up to this rather than time to judge against the same notes
+    double state_time;
+
+    // the value of the knob, if this is a knob event
+    float value;
+
+    // the InputEventType of this event
+    uint8_t type;
+
+    // the lane of this event
+    uint8_t lane;
+
+    // whether or not the button is pressed, if this is a button event
+    uint8_t pressed;
+} ReplayEvent;
+
+typedef struct
+{
+    // always REPLAY_MAGIC, without a terminator
+    char magic[4];
+
+    // the REPLAY_VERSION this replay was written with
+    uint32_t version;
+
+    // the size of a ReplayEvent when this replay was written
+    uint32_t event_size;
+
+    // the number of events following this header
+    uint32_t num_events;
+} ReplayHeader;
+
+// the input events of a play session, in the order they were judged
+typedef struct
+{
+    // the events of this replay, in the order they were judged, which is sorted by state_time
+    ReplayEvent *events;
+    int num_events;
+
+    // the number of events that events has room for
+    int max_events;
+} Replay;
+
+// create an empty replay to record events into
+Replay *replay_create();
+
+// load the replay file at the given path
+// returns NULL if the file does not exist or was not written by this version
+Replay *replay_load(const char *path);
+
+void replay_free(Replay *replay);
+
+// add the given event to the end of the given replay
+// events must be added in the order they were judged
+void replay_add_event(Replay *replay, ReplayEvent event);
+
+// write the given replay to the file at the given path
+// returns whether or not the file was written
+bool replay_write(Replay *replay, const char *path);
+
+// get the index of the first event in the given replay with a state_time after the given chart time
+// returns num_events if there are none
+int replay_find(Replay *replay, double time);
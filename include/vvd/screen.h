@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <EGL/egl.h>
 
 // following standards from sdvx
@@ -23,4 +24,19 @@ Screen *screen_create();
 void screen_free(Screen *screen);
 
 // updates the given screens egl context
-void screen_update(Screen *screen);
+// returns how long, in nanoseconds, swapping the buffers took, which includes waiting for vsync
+int64_t screen_update(Screen *screen);
+
+//
+// BACKEND
+// implemented by the screen backend selected with SCREEN_BACKEND in the makefile
+//
+
+// get the egl display to create a screen on
+EGLDisplay screen_backend_get_display();
+
+// get the EGL_SURFACE_TYPE bits of the surfaces this backend creates
+EGLint screen_backend_surface_type();
+
+// create a SCREEN_WIDTH by SCREEN_HEIGHT egl surface on the given display with the given config
+EGLSurface screen_backend_create_surface(EGLDisplay display, EGLConfig config);
@@ -2,7 +2,35 @@
 
 #include <GLES2/gl2.h>
 
-// creates a shader of the given type with source from the given source path and sets shader to its id
+// the default float precision given to every fragment shader
+#define SHADER_FRAGMENT_PRECISION "precision mediump float;\n"
+
+// the maximum number of distinct shaders that can exist at once
+#define SHADER_MAX_SHADERS 32
+
+// a compiled shader that is shared between every program using the same source
+typedef struct
+{
+    // the type and source path of this shader
+    GLenum type;
+    char *source_path;
+
+    // the id of this shader
+    GLuint id;
+
+    // the number of shader_create calls that returned this shader without a matching shader_free
+    int references;
+} Shader;
+
+// read the source of the shader at the given source path
 // the source path should be relative to the shaders folder
+// returns an allocated string that must be freed by the caller
+char *shader_read_source(const char *source_path);
+
+// sets shader to the id of a shader of the given type compiled from the given source, read from the given source path
+// the first call for a type and source path compiles the shader, and later calls share it until it is freed
 // program_create should almost always be used instead of this directly
-void shader_create(GLuint *shader, GLenum type, const char *source_path);
+void shader_create(GLuint *shader, GLenum type, const char *source_path, const char *source);
+
+// release a shader from shader_create, deleting it once nothing uses it
+void shader_free(GLuint shader);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "chart.h"
+
+// the size in subbeats of a tick
+#define TIMELINE_TICK_SIZE 12
+
+// if the current tempo is >= this value, then the tick size should double, halving the tick rate
+#define TIMELINE_HALF_TICK_RATE_BPM 256
+
+typedef enum
+{
+    // the tempo at index in the charts tempos starts
+    TimelineEventTempo,
+
+    // the bt/fx note at index on lane leaves its maximum timing window
+    TimelineEventBtLeave,
+    TimelineEventFxLeave,
+
+    // the slam segment starting at point of the analog at index on lane leaves its timing window
+    TimelineEventSlamLeave,
+
+    // the bt/fx note at index on lane enters its maximum timing window
+    TimelineEventBtEnter,
+    TimelineEventFxEnter,
+
+    // the slam segment starting at point of the analog at index on lane enters its timing window
+    TimelineEventSlamEnter,
+
+    // tick number index occurs at subbeat
+    TimelineEventTick,
+} TimelineEventType;
+
+// a single event in a timeline
+// kept to 16 bytes so the whole timeline stays compact
+typedef struct
+{
+    // the time of this event, in milliseconds
+    double time;
+
+    // the index of the tempo, note or analog, or the tick number, of this event
+    int32_t index;
+
+    // the subbeat of this event if it is a tick, or the start point of the segment if it is a slam
+    uint16_t subbeat;
+
+    // the TimelineEventType of this event
+    uint8_t type;
+
+    // the lane of this event, if it is a note or slam
+    uint8_t lane;
+} TimelineEvent;
+
+// every timed event of a chart, sorted by time
+typedef struct
+{
+    int num_events;
+    TimelineEvent *events;
+} Timeline;
+
+// create the timeline of the given chart
+Timeline *timeline_create(Chart *chart);
+void timeline_free(Timeline *timeline);
+
+// get the index of the first event in the given timeline that occurs after the given time
+// returns num_events if there are no events after the given time
+int timeline_find(Timeline *timeline, double time);
@@ -1,4 +1,26 @@
 #pragma once
 
-// get the current time in milliseconds
-double time_milliseconds();
+#include <stdint.h>
+#include <stdbool.h>
+
+// the number of nanoseconds in a millisecond and a second
+#define TIME_NANOSECONDS_PER_MILLISECOND 1000000LL
+#define TIME_NANOSECONDS_PER_SECOND 1000000000LL
+
+// get the current time in nanoseconds
+// the time is monotonic, so it never jumps, and it only means anything relative to other times from this clock
+int64_t time_nanoseconds();
+
+// convert between nanoseconds and milliseconds
+// chart times are kept in milliseconds, so these convert clock times to and from them
+double time_nanoseconds_to_milliseconds(int64_t nanoseconds);
+int64_t time_milliseconds_to_nanoseconds(double milliseconds);
+
+// get the deadline for the given duration in nanoseconds from now
+int64_t time_deadline(int64_t duration);
+
+// get whether or not the given deadline has passed
+bool time_deadline_passed(int64_t deadline);
+
+// sleep until the given deadline, returning immediately if it has already passed
+void time_sleep_until(int64_t deadline);
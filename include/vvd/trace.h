@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// the number of events the trace holds, once full the oldest events are overwritten
+// must be a power of two
+#define TRACE_MAX_EVENTS 65536
+
+typedef enum
+{
+    // a span named name started or ended
+    TraceEventBegin,
+    TraceEventEnd,
+
+    // the counter named name changed to value
+    TraceEventCounter,
+} TraceEventType;
+
+typedef struct
+{
+    // the time this event occured at, from time_nanoseconds
+    int64_t time;
+
+    // the name of the span or counter of this event
+    // must outlive the trace, so it is always a string literal
+    const char *name;
+
+    // the value of the counter, if this is a counter event
+    double value;
+
+    // the TraceEventType of this event
+    uint8_t type;
+} TraceEvent;
+
+// spans and counters of the main thread, recorded into a ring buffer for viewing in chrome://tracing or perfetto
+// tracing is always compiled in but off by default, so each call is a single branch until trace_set_enabled is called
+// events are only recorded from the main thread
+
+// start or stop recording events
+void trace_set_enabled(bool enabled);
+
+// get whether or not events are being recorded
+bool trace_enabled();
+
+// record the start and end of a span with the given name
+// spans must end in the reverse order they began
+void trace_begin(const char *name);
+void trace_end(const char *name);
+
+// record the value of the counter with the given name
+void trace_counter(const char *name, double value);
+
+// write the recorded events to the file at the given path as chrome trace event json
+// returns whether or not the file was written
+bool trace_write_json(const char *path);
+
+// write the recorded events to the file at the given path when the process exits, or is stopped by SIGINT or SIGTERM
+// the path must outlive the trace
+// on SIGINT or SIGTERM the trace is written and the process stopped by the next call to trace_handle_signals
+void trace_write_json_on_exit(const char *path);
+
+// if SIGINT or SIGTERM was received since trace_write_json_on_exit, write the trace and stop the process
+// called once per frame by screen_update, so the trace is written from the main loop rather than the signal handler
+void trace_handle_signals();
@@ -7,6 +7,7 @@
 #include "measure_bar_mesh.h"
 #include "note_mesh.h"
 #include "analog_mesh.h"
+#include "render_queue.h"
 
 //
 // TRACK
@@ -51,20 +52,55 @@
 // the offset, on the z axis, of the camera from the start of the track
 #define TRACK_CAMERA_OFFSET -1.0f
 
+// the passes a track is drawn in, in order
+// normal blending depends on the order things are drawn in, so each layer gets its own pass
+// additive blending does not, so additive layers can share a pass
+typedef enum
+{
+    TrackPassLane,
+    TrackPassMeasureBars,
+    TrackPassBtBeams,
+    TrackPassFxBeams,
+    TrackPassHolds,
+    TrackPassFxChips,
+    TrackPassBtChips,
+    TrackPassAnalogs,
+} TrackPass;
+
 typedef struct
 {
     // the current judgement of this beam
     Judgement judgement;
 
-    // the last time that judgement was set on this beam
-    double time;
+    // the last time, from time_nanoseconds, that judgement was set on this beam
+    int64_t time;
 } BeamState;
 
+// the properties of the frame a track is drawing, shared by all the draw commands of the frame
+typedef struct
+{
+    // the model matrix of the track, and of vertices starting at the beginning of the track
+    mat4_t model, offset_model;
+
+    // the model matrix of vertices scrolling with the track
+    mat4_t scrolled_model;
+
+    // the subbeat and speed being drawn
+    double subbeat, speed;
+
+    // the range of subbeats that are visible
+    uint16_t start_subbeat, end_subbeat;
+} TrackFrame;
+
 typedef struct
 {
     // the chart this track is displaying
     Chart *chart;
 
+    // the view projection matrix of the tracks camera
+    // the camera never moves, so this is only calculated once
+    mat4_t view_projection;
+
     // the lane (track background) program and mesh
     Program *lane_program;
     GLuint uniform_lane_lane_id;
@@ -86,6 +122,12 @@ typedef struct
     MeasureBarMesh *measure_bar_mesh;
     NoteMesh *bt_mesh, *fx_mesh;
     AnalogMesh *analog_mesh;
+
+    // the queue the draw commands of each frame are sorted in
+    RenderQueue *render_queue;
+
+    // the frame currently being drawn
+    TrackFrame frame;
 } Track;
 
 Track *track_create(Chart *chart);
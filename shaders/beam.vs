@@ -1,10 +1,8 @@
 attribute vec3 vertexPosition;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+uniform mat4 mvp;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(vertexPosition, 1.0);
+    gl_Position = mvp * vec4(vertexPosition, 1.0);
 }
@@ -1,14 +1,14 @@
-uniform int state;
+varying float state;
 
 void main()
 {
-    if (state == 0)
+    if (state < 0.5)
         // default
         gl_FragColor = vec4(0.8, 0.8, 0.8, 1);
-    else if (state == 1)
+    else if (state < 1.5)
         // error
         gl_FragColor = vec4(0.5, 0.5, 0.5, 1);
-    else if (state == 2)
+    else
         // critical
         gl_FragColor = vec4(1, 1, 1, 1);
 }
@@ -1,13 +1,16 @@
-attribute vec3 vertexPosition;
+attribute vec2 vertexPosition;
+attribute float vertexTrackPosition;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+uniform mat4 mvp;
 
 uniform float speed;
-uniform float position;
+uniform float positionRange;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(vertexPosition.x, (position * speed) + vertexPosition.y, vertexPosition.z, 1.0);
+    // vertexPosition is normalized, so scale it back up to its range
+    vec2 position = vertexPosition * positionRange;
+
+    // the track position of the chip is scaled by speed and offset by the vertices y within the chip
+    gl_Position = mvp * vec4(position.x, (vertexTrackPosition * speed) + position.y, 0.0, 1.0);
 }
@@ -1,14 +1,14 @@
-uniform int state;
+varying float state;
 
 void main()
 {
-    if (state == 0)
+    if (state < 0.5)
         // default
         gl_FragColor = vec4(0.88, 0.58, 0.1, 0.7);
-    else if (state == 1)
+    else if (state < 1.5)
         // error
         gl_FragColor = vec4(0.88, 0.58, 0.1, 0.5);
-    else if (state == 2)
+    else
         // critical
         gl_FragColor = vec4(0.88, 0.58, 0.1, 0.8);
 }
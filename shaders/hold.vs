@@ -1,12 +1,19 @@
-attribute vec3 vertexPosition;
+attribute vec2 vertexPosition;
+attribute float vertexTrackPosition;
+attribute float vertexState;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+uniform mat4 mvp;
 
 uniform float speed;
+uniform float positionRange;
+
+varying float state;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(vertexPosition.x, vertexPosition.y * speed, vertexPosition.z, 1.0);
+    // vertexPosition is normalized, so scale it back up to its range
+    vec2 position = vertexPosition * positionRange;
+
+    state = vertexState;
+    gl_Position = mvp * vec4(position.x, (vertexTrackPosition * speed) + position.y, 0.0, 1.0);
 }
@@ -1,13 +1,11 @@
 attribute vec3 vertexPosition;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+uniform mat4 mvp;
 
 uniform float speed;
 uniform float position;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(vertexPosition.x, (position * speed) + vertexPosition.y, vertexPosition.z, 1.0);
+    gl_Position = mvp * vec4(vertexPosition.x, (position * speed) + vertexPosition.y, vertexPosition.z, 1.0);
 }
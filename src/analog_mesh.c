@@ -1,6 +1,8 @@
 #include "analog_mesh.h"
 
 #include "track.h"
+#include "gl_stats.h"
+#include "profile.h"
 
 float analog_point_draw_position(AnalogPoint *point)
 {
@@ -15,26 +17,26 @@ void create_segment_vertices(Mesh *mesh,
                              AnalogPoint *end_point,
                              float slam_height)
 {
-    // get the segments start position
+    // get the segments start position, with its position along the track in z
     vec3_t start_position = vec3(analog_point_draw_position(start_point),
-                                 track_subbeat_position(start_point->subbeat),
-                                 0);
+                                 0,
+                                 track_subbeat_position(start_point->subbeat));
 
     // offset the start of the segment if the last segment was a slam, so the vertices arent overlaying eachother
     if (start_point->slam)
-        start_position.y += slam_height;
+        start_position.z += slam_height;
 
     // get the segments end position
     vec3_t end_position = vec3(analog_point_draw_position(end_point),
-                               track_subbeat_position(end_point->subbeat),
-                               0);
+                               0,
+                               track_subbeat_position(end_point->subbeat));
 
     // create the vertices
-    mesh_set_vertices_quad_edges(mesh,
-                                 *vertices_index,
-                                 ANALOG_MESH_SEGMENT_WIDTH,
-                                 start_position,
-                                 end_position);
+    mesh_set_compact_quad_edges(mesh,
+                                *vertices_index,
+                                ANALOG_MESH_SEGMENT_WIDTH,
+                                start_position,
+                                end_position);
 
     // increment vertices_index
     *vertices_index += ANALOG_MESH_SEGMENT_SIZE;
@@ -47,10 +49,10 @@ void create_slam_vertices(Mesh *mesh,
                           bool last_segment,
                           float height)
 {
-    // get the slams position
+    // get the slams position, with its position along the track in z
     vec3_t position = vec3(0,
-                           track_subbeat_position(start_point->subbeat),
-                           0);
+                           0,
+                           track_subbeat_position(start_point->subbeat));
 
     // get the slams x position depending on which point is closer to 0
     if (start_point->position < end_point->position)
@@ -63,11 +65,11 @@ void create_slam_vertices(Mesh *mesh,
     float width = fabs(analog_point_draw_position(end_point) - analog_point_draw_position(start_point)) + ANALOG_MESH_SEGMENT_WIDTH;
 
     // create the slam vertices
-    mesh_set_vertices_quad(mesh,
-                           *vertices_index,
-                           width,
-                           height,
-                           position);
+    mesh_set_compact_quad_edges(mesh,
+                                *vertices_index,
+                                width,
+                                position,
+                                vec3(position.x, 0, position.z + height));
 
     // increment vertices_index
     *vertices_index += ANALOG_MESH_SLAM_SIZE;
@@ -77,15 +79,15 @@ void create_slam_vertices(Mesh *mesh,
     {
         // get the tails position
         vec3_t tail_position = vec3(analog_point_draw_position(end_point),
-                                    position.y + height,
-                                    0);
+                                    0,
+                                    position.z + height);
 
         // create the tail vertices
-        mesh_set_vertices_quad(mesh,
-                               *vertices_index,
-                               ANALOG_MESH_SEGMENT_WIDTH,
-                               height,
-                               tail_position);
+        mesh_set_compact_quad_edges(mesh,
+                                    *vertices_index,
+                                    ANALOG_MESH_SEGMENT_WIDTH,
+                                    tail_position,
+                                    vec3(tail_position.x, 0, tail_position.z + height));
 
         // increment vertices_index
         *vertices_index += ANALOG_MESH_SLAM_TAIL_SIZE;
@@ -167,6 +169,8 @@ void load_analogs(AnalogMesh *mesh)
 
 AnalogMesh *analog_mesh_create(Chart *chart)
 {
+    int profile_phase = profile_begin("analog_mesh_create");
+
     // create the mesh
     AnalogMesh *mesh = malloc(sizeof(AnalogMesh));
 
@@ -178,10 +182,18 @@ AnalogMesh *analog_mesh_create(Chart *chart)
     mesh->uniform_speed_id = program_get_uniform_id(mesh->program, "speed");
     mesh->uniform_lane_id = program_get_uniform_id(mesh->program, "lane");
 
-    // get the size of all the segments in the given charts analogs
+    // get the segments of the given charts analogs and the size of all of them
     size_t mesh_size = 0;
     for (int l = 0; l < CHART_ANALOG_LANES; l++)
     {
+        mesh->num_segments[l] = 0;
+        for (int a = 0; a < chart->num_analogs[l]; a++)
+            if (chart->analogs[l][a].num_points > 1)
+                mesh->num_segments[l] += chart->analogs[l][a].num_points - 1;
+
+        mesh->segments[l] = malloc(mesh->num_segments[l] * sizeof(AnalogMeshSegment));
+
+        int segment_index = 0;
         for (int a = 0; a < chart->num_analogs[l]; a++)
         {
             Analog *analog = &chart->analogs[l][a];
@@ -191,24 +203,40 @@ AnalogMesh *analog_mesh_create(Chart *chart)
                 AnalogPoint *start_point = &analog->points[p];
                 AnalogPoint *end_point = &analog->points[p + 1];
 
+                // get the size of the current segment
+                int segment_size;
                 if (end_point->slam)
                 {
-                    mesh_size += ANALOG_MESH_SLAM_SIZE;
+                    segment_size = ANALOG_MESH_SLAM_SIZE;
 
                     if (p == analog->num_points - 2)
-                        mesh_size += ANALOG_MESH_SLAM_TAIL_SIZE;
+                        segment_size += ANALOG_MESH_SLAM_TAIL_SIZE;
                 }
                 else
-                    mesh_size += ANALOG_MESH_SEGMENT_SIZE;
+                    segment_size = ANALOG_MESH_SEGMENT_SIZE;
+
+                mesh->segments[l][segment_index++] = (AnalogMeshSegment)
+                {
+                    .start_subbeat = start_point->subbeat,
+                    .end_subbeat = end_point->subbeat,
+                    .vertices_index = mesh_size,
+                    .num_vertices = segment_size,
+                };
+
+                mesh_size += segment_size;
             }
         }
     }
 
     // create the analogs mesh
-    mesh->mesh = mesh_create(mesh_size, mesh->program, GL_STATIC_DRAW);
+    mesh->mesh = mesh_create_compact(mesh_size, mesh->program, GL_STATIC_DRAW);
 
-    // load the analogs
+    // load the analogs, building the mesh on the cpu and uploading it once
+    mesh_stage_vertices(mesh->mesh);
     load_analogs(mesh);
+    mesh_upload_vertices(mesh->mesh);
+
+    profile_end(profile_phase);
 
     // return the mesh
     return mesh;
@@ -219,25 +247,43 @@ void analog_mesh_free(AnalogMesh *mesh)
     // free the program
     program_free(mesh->program);
 
-    // free the analogs mesh
+    // free the analogs mesh and segments
     mesh_free(mesh->mesh);
 
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+        free(mesh->segments[l]);
+
     // free the mesh
     free(mesh);
 }
 
+int find_segment(AnalogMeshSegment *segments, int low, int high, uint16_t subbeat, bool by_start)
+{
+    // get the index of the first of the given segments between low and high that ends at or after the given subbeat
+    // or if by_start, the index of the first that starts after the given subbeat
+    // returns high if there are none
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        bool before = by_start ? (segments[middle].start_subbeat <= subbeat) : (segments[middle].end_subbeat < subbeat);
+
+        if (before)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
 void analog_mesh_draw(AnalogMesh *mesh,
-                      mat4_t projection,
-                      mat4_t view,
+                      mat4_t view_projection,
                       mat4_t model,
                       double position,
                       uint16_t start_subbeat,
                       uint16_t end_subbeat,
                       double speed)
 {
-    // additive blending for analogs
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-
     // offset speed
     speed += ANALOG_MESH_SPEED_OFFSET;
 
@@ -246,47 +292,27 @@ void analog_mesh_draw(AnalogMesh *mesh,
 
     // draw the analogs
     program_use(mesh->program);
-    program_set_matrices(mesh->program, projection, view, model);
+    program_set_mvp(mesh->program, m4_mul(view_projection, model));
     glUniform1f(mesh->uniform_speed_id, speed);
     mesh_draw_start(mesh->mesh);
 
-    int vertices_index = 0;
     for (int l = 0; l < CHART_ANALOG_LANES; l++)
     {
-        glUniform1i(mesh->uniform_lane_id, l);
+        // get the range of segments on the current lane that are in range
+        AnalogMeshSegment *segments = mesh->segments[l];
+        int first_segment = find_segment(segments, 0, mesh->num_segments[l], start_subbeat, false);
+        int last_segment = find_segment(segments, first_segment, mesh->num_segments[l], end_subbeat, true);
 
-        for (int a = 0; a < mesh->chart->num_analogs[l]; a++)
-        {
-            Analog *analog = &mesh->chart->analogs[l][a];
-
-            for (int p = 0; p < analog->num_points - 1; p++)
-            {
-                AnalogPoint *start_point = &analog->points[p];
-                AnalogPoint *end_point = &analog->points[p + 1];
-
-                // the size, in vertices, of the current segment
-                int segment_size;
-
-                // get the size of the current segment
-                if (end_point->slam)
-                {
-                    segment_size = ANALOG_MESH_SLAM_SIZE;
-
-                    if (p == analog->num_points - 2)
-                        segment_size += ANALOG_MESH_SLAM_TAIL_SIZE;
-                }
-                else
-                    segment_size = ANALOG_MESH_SEGMENT_SIZE;
+        // skip the current lane if it has no segments in range
+        if (first_segment >= last_segment)
+            continue;
 
-                // draw the current segment if it is in range
-                if (end_point->subbeat >= start_subbeat &&
-                    start_point->subbeat <= end_subbeat)
-                    mesh_draw_vertices(mesh->mesh, vertices_index, segment_size);
+        // draw all the segments in range in one draw, as the vertices of a lanes segments are contiguous
+        AnalogMeshSegment *last = &segments[last_segment - 1];
+        int vertices_index = segments[first_segment].vertices_index;
 
-                // increment the vertices index
-                vertices_index += segment_size;
-            }
-        }
+        glUniform1i(mesh->uniform_lane_id, l);
+        mesh_draw_vertices(mesh->mesh, vertices_index, last->vertices_index + last->num_vertices - vertices_index);
     }
 
     mesh_draw_end(mesh->mesh);
@@ -5,9 +5,12 @@
 #include <linux/limits.h>
 
 #include "bass_utils.h"
+#include "profile.h"
 
 AudioTrack *audio_track_create(const char *path)
 {
+    int profile_phase = profile_begin("audio_track_create");
+
     AudioTrack *track = malloc(sizeof(AudioTrack));
 
     // load the track
@@ -18,6 +21,7 @@ AudioTrack *audio_track_create(const char *path)
         bass_error(message);
     }
 
+    profile_end(profile_phase);
     return track;
 }
 
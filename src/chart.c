@@ -4,100 +4,218 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "chart_vox.h"
+#include "chart_cache.h"
 #include "note_utils.h"
 #include "shared.h"
+#include "profile.h"
+
+void chart_parse_lines(Chart *chart,
+                       const char *data,
+                       size_t size,
+                       void *parsing_state,
+                       void (* parse_line)(Chart *, void *, const char *, const char *))
+{
+    // the cursor for the start of the current line and the end of the file
+    const char *cursor = data;
+    const char *end = data + size;
+
+    // skip the bom if there is one
+    if (size >= 3 &&
+        (uint8_t)cursor[0] == 0xEF &&
+        (uint8_t)cursor[1] == 0xBB &&
+        (uint8_t)cursor[2] == 0xBF)
+        cursor += 3;
+
+    // pass each line into parse_line
+    while (cursor < end)
+    {
+        // find the end of the current line, and where the next line starts
+        const char *line_end = memchr(cursor, '\n', end - cursor);
+        const char *next_line = line_end ? line_end + 1 : end;
+
+        if (!line_end)
+            line_end = end;
+
+        // cut the line at the first carriage return
+        const char *carriage_return = memchr(cursor, '\r', line_end - cursor);
+        if (carriage_return)
+            line_end = carriage_return;
+
+        // parse the line
+        parse_line(chart, parsing_state, cursor, line_end);
+
+        // move to the next line
+        cursor = next_line;
+    }
+}
+
+size_t chart_arena_reserve(size_t *arena_size, size_t size)
+{
+    // reserve an aligned block of the given size at the end of an arena and return its offset
+    size_t offset = (*arena_size + CHART_ARENA_ALIGNMENT - 1) & ~(size_t)(CHART_ARENA_ALIGNMENT - 1);
+    *arena_size = offset + size;
+    return offset;
+}
+
+void chart_allocate_arena(Chart *chart)
+{
+    // lay out every value of the given chart, using the counts from the counting pass
+    size_t size = 0;
+
+    // metadata strings are not part of vox files, so they are all one shared empty string
+    size_t strings_offset = chart_arena_reserve(&size, sizeof(char));
+    size_t beats_offset = chart_arena_reserve(&size, chart->num_beats * sizeof(Beat));
+    size_t tempos_offset = chart_arena_reserve(&size, chart->num_tempos * sizeof(Tempo));
+
+    size_t bt_notes_offsets[CHART_BT_LANES];
+    for (int i = 0; i < CHART_BT_LANES; i++)
+        bt_notes_offsets[i] = chart_arena_reserve(&size, chart->num_bt_notes[i] * sizeof(Note));
+
+    size_t fx_notes_offsets[CHART_FX_LANES];
+    for (int i = 0; i < CHART_FX_LANES; i++)
+        fx_notes_offsets[i] = chart_arena_reserve(&size, chart->num_fx_notes[i] * sizeof(Note));
+
+    size_t analogs_offsets[CHART_ANALOG_LANES];
+    size_t analog_points_offsets[CHART_ANALOG_LANES];
+    for (int i = 0; i < CHART_ANALOG_LANES; i++)
+    {
+        analogs_offsets[i] = chart_arena_reserve(&size, chart->num_analogs[i] * sizeof(Analog));
+        analog_points_offsets[i] = chart_arena_reserve(&size, chart->num_analog_points[i] * sizeof(AnalogPoint));
+    }
+
+    // allocate the arena
+    char *arena = malloc(size);
+    assert(arena);
+    chart->arena = arena;
+
+    // point the chart into the arena and reset the counts so the filling pass can append to them
+    arena[strings_offset] = '\0';
+    chart->title = &arena[strings_offset];
+    chart->artist = &arena[strings_offset];
+    chart->effector = &arena[strings_offset];
+    chart->illustrator = &arena[strings_offset];
+
+    chart->beats = (Beat *)&arena[beats_offset];
+    chart->num_beats = 0;
+    chart->tempos = (Tempo *)&arena[tempos_offset];
+    chart->num_tempos = 0;
+
+    for (int i = 0; i < CHART_BT_LANES; i++)
+    {
+        chart->bt_notes[i] = (Note *)&arena[bt_notes_offsets[i]];
+        chart->num_bt_notes[i] = 0;
+    }
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+    {
+        chart->fx_notes[i] = (Note *)&arena[fx_notes_offsets[i]];
+        chart->num_fx_notes[i] = 0;
+    }
+
+    for (int i = 0; i < CHART_ANALOG_LANES; i++)
+    {
+        chart->analogs[i] = (Analog *)&arena[analogs_offsets[i]];
+        chart->num_analogs[i] = 0;
+        chart->analog_points[i] = (AnalogPoint *)&arena[analog_points_offsets[i]];
+        chart->num_analog_points[i] = 0;
+    }
+}
 
 void chart_parse_file(Chart *chart,
                       const char *path,
-                      void *(* parsing_state_create)(),
+                      void *(* parsing_state_create)(bool),
                       void (* parsing_state_free)(void *),
-                      void (* parse_line)(Chart *, void *, char *))
+                      void (* parse_line)(Chart *, void *, const char *, const char *))
 {
     // open the chart file for reading
-    FILE *file = fopen(path, "r");
+    int fd = open(path, O_RDONLY);
 
     // assert that the file is opened
-    assert(file);
+    assert(fd >= 0);
 
-    // read each line and pass it into parse_line
-    char line[CHART_STR_MAX];
-    void *parsing_state = parsing_state_create();
+    // get the size of the file
+    struct stat file_stat;
+    int result = fstat(fd, &file_stat);
+    assert(result == 0);
 
-    while (fgets(line, CHART_STR_MAX, file))
+    size_t size = file_stat.st_size;
+
+    // map the file so it can be walked in place instead of copying every line out
+    // empty files cannot be mapped, so they are left as a null range
+    const char *data = NULL;
+    if (size > 0)
     {
-        // cleanup the line by removing newlines, carriage returns, and boms
-        char *position;
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        assert(data != MAP_FAILED);
 
-        // remove newlines
-        if ((position = strchr(line, '\r')))
-            *position = '\0';
+        // the file is only ever read front to back
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
 
-        // remove carriage returns
-        if ((position = strchr(line, '\n')))
-            *position = '\0';
+    // the mapping keeps its own reference to the file
+    close(fd);
 
-        // skip the bom if there is one
-        int offset = 0;
+    // count everything in the chart so its arena can be sized exactly
+    void *parsing_state = parsing_state_create(true);
+    chart_parse_lines(chart, data, size, parsing_state, parse_line);
+    parsing_state_free(parsing_state);
 
-        if (line[0] == 0xEF &&
-            line[1] == 0xBB &&
-            line[2] == 0xBF)
-            offset = 3;
+    chart_allocate_arena(chart);
 
-        // parse the line
-        parse_line(chart, parsing_state, line + offset);
-    }
-
-    // free the parsing state and close the file
+    // fill the chart
+    parsing_state = parsing_state_create(false);
+    chart_parse_lines(chart, data, size, parsing_state, parse_line);
     parsing_state_free(parsing_state);
-    fclose(file);
+
+    // unmap the file
+    if (data)
+        munmap((void *)data, size);
 }
 
 Chart *chart_create(const char *path)
 {
-    Chart *chart = malloc(sizeof(Chart));
+    int profile_phase = profile_begin("chart_create");
+
+    // use the compiled cache of the chart if there is a valid one, as it doesnt need any parsing
+    Chart *chart = chart_cache_load(path);
+    if (chart)
+    {
+        profile_end(profile_phase);
+        return chart;
+    }
+
+    chart = malloc(sizeof(Chart));
+    chart->cache_data = NULL;
+    chart->cache_size = 0;
 
     // default the offset and count properties to zero
     chart->offset = 0;
     chart->num_beats = 0;
     chart->num_tempos = 0;
 
-    // allocate all the strings
-    chart->title = malloc(CHART_STR_MAX * sizeof(char));
-    chart->artist = malloc(CHART_STR_MAX * sizeof(char));
-    chart->effector = malloc(CHART_STR_MAX * sizeof(char));
-    chart->illustrator = malloc(CHART_STR_MAX * sizeof(char));
-
-    // allocate all the events
-    chart->beats = malloc(CHART_EVENTS_MAX * sizeof(Beat));
-    chart->tempos = malloc(CHART_EVENTS_MAX * sizeof(Tempo));
-
-    // allocate all the notes
     for (int i = 0; i < CHART_BT_LANES; i++)
-    {
         chart->num_bt_notes[i] = 0;
-        chart->bt_notes[i] = malloc(CHART_NOTES_MAX * sizeof(Note));
-    }
 
     for (int i = 0; i < CHART_FX_LANES; i++)
-    {
         chart->num_fx_notes[i] = 0;
-        chart->fx_notes[i] = malloc(CHART_NOTES_MAX * sizeof(Note));
-    }
 
     for (int i = 0; i < CHART_ANALOG_LANES; i++)
     {
         chart->num_analogs[i] = 0;
-        chart->analogs[i] = malloc(CHART_NOTES_MAX * sizeof(Analog));
+        chart->num_analog_points[i] = 0;
     }
 
     // get the proper chart parsing methods for the given path
     const char *path_extension = strrchr(path, '.');
-    void *(* parsing_state_create)();
-    void (* parsing_state_free)(void *);
-    void (* parse_line)(Chart *, void *, char *);
+    void *(* parsing_state_create)(bool) = NULL;
+    void (* parsing_state_free)(void *) = NULL;
+    void (* parse_line)(Chart *, void *, const char *, const char *) = NULL;
 
     // if there is a path extension
     if (path_extension)
@@ -174,36 +292,23 @@ Chart *chart_create(const char *path)
     // set the charts main bpm
     chart->main_bpm = bpms[main_index];
 
+    // compile the chart so the next load can skip parsing
+    chart_cache_write(chart, path);
+
+    profile_end(profile_phase);
+
     // return the loaded chart
     return chart;
 }
 
 void chart_free(Chart *chart)
 {
-    // free all the strings
-    free(chart->title);
-    free(chart->artist);
-    free(chart->effector);
-    free(chart->illustrator);
-
-    // free all the events
-    free(chart->beats);
-    free(chart->tempos);
+    // free the arena, which holds every value of the chart that is not in its cache
+    free(chart->arena);
 
-    // free all the notes
-    for (int i = 0; i < CHART_BT_LANES; i++)
-        free(chart->bt_notes[i]);
-
-    for (int i = 0; i < CHART_FX_LANES; i++)
-        free(chart->fx_notes[i]);
-
-    for (int l = 0; l < CHART_ANALOG_LANES; l++)
-    {
-        for (int a = 0; a < chart->num_analogs[l]; a++)
-            free(chart->analogs[l][a].points);
-
-        free(chart->analogs[l]);
-    }
+    // unmap the cache if the chart was loaded from one
+    if (chart->cache_data)
+        munmap(chart->cache_data, chart->cache_size);
 
     // free the chart
     free(chart);
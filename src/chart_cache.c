@@ -0,0 +1,416 @@
+#include "chart_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+
+// fnv-1a 64 bit constants
+#define CHART_CACHE_HASH_OFFSET 0xcbf29ce484222325ULL
+#define CHART_CACHE_HASH_PRIME 0x100000001b3ULL
+
+// whether or not caches are loaded and written
+static bool enabled = true;
+
+void chart_cache_set_enabled(bool value)
+{
+    enabled = value;
+}
+
+bool chart_cache_path(const char *source_path, char output_path[PATH_MAX])
+{
+    // get the length of the source path without its extension
+    // only remove the extension if it is in the file name and not a directory name
+    const char *extension = strrchr(source_path, '.');
+    const char *directory = strrchr(source_path, '/');
+    int length = (extension && (!directory || extension > directory)) ? extension - source_path : strlen(source_path);
+
+    // write the source path with the cache extension instead
+    // fail if the path is too long, rather than using a cache at a truncated path
+    int written = snprintf(output_path, PATH_MAX, "%.*s%s", length, source_path, CHART_CACHE_EXTENSION);
+    if (written < 0 || written >= PATH_MAX)
+    {
+        printf("chart_cache_path: cache path for '%s' is too long\n", source_path);
+        return false;
+    }
+
+    return true;
+}
+
+void chart_cache_touch(const char *path, const struct stat *source_stat)
+{
+    // set the source modification time in the header of the cache at the given path to that of the given source
+    // so the next load can trust the modification time again instead of hashing the source
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return;
+
+    int64_t seconds = source_stat->st_mtim.tv_sec;
+    int64_t nanoseconds = source_stat->st_mtim.tv_nsec;
+
+    if (pwrite(fd, &seconds, sizeof(seconds), offsetof(ChartCacheHeader, source_mtime_seconds)) != sizeof(seconds) ||
+        pwrite(fd, &nanoseconds, sizeof(nanoseconds), offsetof(ChartCacheHeader, source_mtime_nanoseconds)) != sizeof(nanoseconds))
+        printf("chart_cache_touch: unable to update cache '%s'\n", path);
+
+    close(fd);
+}
+
+bool chart_cache_hash_source(const char *source_path, uint64_t *hash)
+{
+    // open the source file
+    int fd = open(source_path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat source_stat;
+    if (fstat(fd, &source_stat) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // hash the source file in place
+    *hash = CHART_CACHE_HASH_OFFSET;
+
+    if (source_stat.st_size > 0)
+    {
+        const uint8_t *data = mmap(NULL, source_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+
+        for (off_t i = 0; i < source_stat.st_size; i++)
+        {
+            *hash ^= data[i];
+            *hash *= CHART_CACHE_HASH_PRIME;
+        }
+
+        munmap((void *)data, source_stat.st_size);
+    }
+
+    close(fd);
+    return true;
+}
+
+bool chart_cache_range_valid(size_t cache_size, uint32_t offset, uint32_t count, size_t record_size)
+{
+    // return whether or not the given range of records is entirely within the cache
+    return offset <= cache_size && (cache_size - offset) / record_size >= count;
+}
+
+bool chart_cache_string_valid(const char *data, size_t cache_size, uint32_t offset)
+{
+    // return whether or not there is a terminated string at offset within the cache
+    return offset < cache_size && memchr(data + offset, '\0', cache_size - offset);
+}
+
+bool chart_cache_header_valid(const char *data, size_t cache_size, const char *path, const char *source_path)
+{
+    const ChartCacheHeader *header = (const ChartCacheHeader *)data;
+
+    // check that the cache is for this version and build of vvd
+    if (memcmp(header->magic, CHART_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CHART_CACHE_VERSION ||
+        header->beat_size != sizeof(Beat) ||
+        header->tempo_size != sizeof(Tempo) ||
+        header->note_size != sizeof(Note) ||
+        header->analog_point_size != sizeof(AnalogPoint))
+        return false;
+
+    // check that every section is within the cache
+    if (!chart_cache_string_valid(data, cache_size, header->title_offset) ||
+        !chart_cache_string_valid(data, cache_size, header->artist_offset) ||
+        !chart_cache_string_valid(data, cache_size, header->effector_offset) ||
+        !chart_cache_string_valid(data, cache_size, header->illustrator_offset) ||
+        !chart_cache_range_valid(cache_size, header->beats.offset, header->beats.count, sizeof(Beat)) ||
+        !chart_cache_range_valid(cache_size, header->tempos.offset, header->tempos.count, sizeof(Tempo)))
+        return false;
+
+    for (int i = 0; i < CHART_BT_LANES; i++)
+        if (!chart_cache_range_valid(cache_size, header->bt_notes[i].offset, header->bt_notes[i].count, sizeof(Note)))
+            return false;
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+        if (!chart_cache_range_valid(cache_size, header->fx_notes[i].offset, header->fx_notes[i].count, sizeof(Note)))
+            return false;
+
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+    {
+        if (!chart_cache_range_valid(cache_size, header->analogs[l].offset, header->analogs[l].count, sizeof(ChartCacheAnalog)) ||
+            !chart_cache_range_valid(cache_size, header->analog_points[l].offset, header->analog_points[l].count, sizeof(AnalogPoint)))
+            return false;
+
+        const ChartCacheAnalog *analogs = (const ChartCacheAnalog *)(data + header->analogs[l].offset);
+        for (int a = 0; a < header->analogs[l].count; a++)
+            if (analogs[a].first_point > header->analog_points[l].count ||
+                analogs[a].num_points > header->analog_points[l].count - analogs[a].first_point)
+                return false;
+    }
+
+    // check that the cache is not stale
+    struct stat source_stat;
+    if (stat(source_path, &source_stat) != 0 || header->source_size != source_stat.st_size)
+        return false;
+
+    // the modification time is checked first so the source only has to be hashed when it was touched
+    if (header->source_mtime_seconds == source_stat.st_mtim.tv_sec &&
+        header->source_mtime_nanoseconds == source_stat.st_mtim.tv_nsec)
+        return true;
+
+    uint64_t source_hash;
+    if (!chart_cache_hash_source(source_path, &source_hash) || source_hash != header->source_hash)
+        return false;
+
+    // the source was only touched, so record its new modification time so it is not hashed again on the next load
+    chart_cache_touch(path, &source_stat);
+    return true;
+}
+
+Chart *chart_cache_load(const char *source_path)
+{
+    if (!enabled)
+        return NULL;
+
+    // open the cache file, if there is one
+    char path[PATH_MAX];
+    if (!chart_cache_path(source_path, path))
+        return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    // get the size of the cache and make sure it at least has a header
+    struct stat cache_stat;
+    if (fstat(fd, &cache_stat) != 0 || cache_stat.st_size < sizeof(ChartCacheHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // map the cache
+    size_t size = cache_stat.st_size;
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return NULL;
+
+    // unmap and say there is no cache if the cache cant be used
+    if (!chart_cache_header_valid(data, size, path, source_path))
+    {
+        munmap(data, size);
+        return NULL;
+    }
+
+    const ChartCacheHeader *header = (const ChartCacheHeader *)data;
+
+    // create the chart and point it into the cache
+    Chart *chart = malloc(sizeof(Chart));
+    chart->cache_data = data;
+    chart->cache_size = size;
+
+    chart->title = data + header->title_offset;
+    chart->artist = data + header->artist_offset;
+    chart->effector = data + header->effector_offset;
+    chart->illustrator = data + header->illustrator_offset;
+
+    chart->rating = header->rating;
+    chart->offset = header->offset;
+    chart->main_bpm = header->main_bpm;
+    chart->end_subbeat = header->end_subbeat;
+    chart->end_time = header->end_time;
+    chart->num_measures = header->num_measures;
+
+    chart->num_beats = header->beats.count;
+    chart->beats = (Beat *)(data + header->beats.offset);
+    chart->num_tempos = header->tempos.count;
+    chart->tempos = (Tempo *)(data + header->tempos.offset);
+
+    for (int i = 0; i < CHART_BT_LANES; i++)
+    {
+        chart->num_bt_notes[i] = header->bt_notes[i].count;
+        chart->bt_notes[i] = (Note *)(data + header->bt_notes[i].offset);
+    }
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+    {
+        chart->num_fx_notes[i] = header->fx_notes[i].count;
+        chart->fx_notes[i] = (Note *)(data + header->fx_notes[i].offset);
+    }
+
+    // analogs are the only records that hold pointers, so they are rebuilt from their offsets into the arena
+    size_t arena_size = 0;
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+        arena_size += header->analogs[l].count * sizeof(Analog);
+
+    Analog *arena = malloc(arena_size);
+    chart->arena = arena;
+
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+    {
+        const ChartCacheAnalog *analogs = (const ChartCacheAnalog *)(data + header->analogs[l].offset);
+
+        chart->num_analog_points[l] = header->analog_points[l].count;
+        chart->analog_points[l] = (AnalogPoint *)(data + header->analog_points[l].offset);
+        chart->num_analogs[l] = header->analogs[l].count;
+        chart->analogs[l] = arena;
+
+        for (int a = 0; a < header->analogs[l].count; a++)
+        {
+            chart->analogs[l][a].num_points = analogs[a].num_points;
+            chart->analogs[l][a].points = &chart->analog_points[l][analogs[a].first_point];
+        }
+
+        arena += header->analogs[l].count;
+    }
+
+    // return the loaded chart
+    return chart;
+}
+
+uint32_t chart_cache_reserve(uint32_t *size, size_t section_size)
+{
+    // reserve an aligned section of the given size at the end of the cache and return its offset
+    uint32_t offset = (*size + CHART_CACHE_ALIGNMENT - 1) & ~(CHART_CACHE_ALIGNMENT - 1);
+    *size = offset + section_size;
+    return offset;
+}
+
+void chart_cache_write_section(FILE *file, uint32_t offset, const void *records, size_t size)
+{
+    // write the given records at the given offset, padding the file up to it
+    while (ftell(file) < offset)
+        fputc(0, file);
+
+    if (size > 0)
+        fwrite(records, size, 1, file);
+}
+
+void chart_cache_write(Chart *chart, const char *source_path)
+{
+    if (!enabled)
+        return;
+
+    // get the path to write the cache to
+    char path[PATH_MAX];
+    if (!chart_cache_path(source_path, path))
+        return;
+
+    // get the size and modification time of the source
+    struct stat source_stat;
+    if (stat(source_path, &source_stat) != 0)
+        return;
+
+    ChartCacheHeader header = (ChartCacheHeader)
+    {
+        .version = CHART_CACHE_VERSION,
+        .beat_size = sizeof(Beat),
+        .tempo_size = sizeof(Tempo),
+        .note_size = sizeof(Note),
+        .analog_point_size = sizeof(AnalogPoint),
+        .source_size = source_stat.st_size,
+        .source_mtime_seconds = source_stat.st_mtim.tv_sec,
+        .source_mtime_nanoseconds = source_stat.st_mtim.tv_nsec,
+        .offset = chart->offset,
+        .main_bpm = chart->main_bpm,
+        .end_time = chart->end_time,
+        .end_subbeat = chart->end_subbeat,
+        .num_measures = chart->num_measures,
+        .rating = chart->rating,
+    };
+
+    memcpy(header.magic, CHART_CACHE_MAGIC, sizeof(header.magic));
+
+    if (!chart_cache_hash_source(source_path, &header.source_hash))
+        return;
+
+    // lay out every section after the header
+    uint32_t size = sizeof(ChartCacheHeader);
+
+    header.title_offset = chart_cache_reserve(&size, strlen(chart->title) + 1);
+    header.artist_offset = chart_cache_reserve(&size, strlen(chart->artist) + 1);
+    header.effector_offset = chart_cache_reserve(&size, strlen(chart->effector) + 1);
+    header.illustrator_offset = chart_cache_reserve(&size, strlen(chart->illustrator) + 1);
+
+    header.beats = (ChartCacheSection){ chart->num_beats, chart_cache_reserve(&size, chart->num_beats * sizeof(Beat)) };
+    header.tempos = (ChartCacheSection){ chart->num_tempos, chart_cache_reserve(&size, chart->num_tempos * sizeof(Tempo)) };
+
+    for (int i = 0; i < CHART_BT_LANES; i++)
+        header.bt_notes[i] = (ChartCacheSection){ chart->num_bt_notes[i], chart_cache_reserve(&size, chart->num_bt_notes[i] * sizeof(Note)) };
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+        header.fx_notes[i] = (ChartCacheSection){ chart->num_fx_notes[i], chart_cache_reserve(&size, chart->num_fx_notes[i] * sizeof(Note)) };
+
+    // the analog records of each lane
+    ChartCacheAnalog *analogs[CHART_ANALOG_LANES];
+
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+    {
+        header.analogs[l] = (ChartCacheSection){ chart->num_analogs[l], chart_cache_reserve(&size, chart->num_analogs[l] * sizeof(ChartCacheAnalog)) };
+        header.analog_points[l] = (ChartCacheSection){ chart->num_analog_points[l], chart_cache_reserve(&size, chart->num_analog_points[l] * sizeof(AnalogPoint)) };
+        analogs[l] = malloc(chart->num_analogs[l] * sizeof(ChartCacheAnalog));
+
+        for (int a = 0; a < chart->num_analogs[l]; a++)
+        {
+            Analog *analog = &chart->analogs[l][a];
+            analogs[l][a].num_points = analog->num_points;
+            analogs[l][a].first_point = analog->points - chart->analog_points[l];
+        }
+    }
+
+    // write to a temporary file and move it over the cache once finished
+    // so an interrupted write never leaves a partial cache behind
+    char temporary_path[PATH_MAX + 4];
+    snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+    FILE *file = fopen(temporary_path, "wb");
+
+    if (file)
+    {
+        fwrite(&header, sizeof(ChartCacheHeader), 1, file);
+
+        chart_cache_write_section(file, header.title_offset, chart->title, strlen(chart->title) + 1);
+        chart_cache_write_section(file, header.artist_offset, chart->artist, strlen(chart->artist) + 1);
+        chart_cache_write_section(file, header.effector_offset, chart->effector, strlen(chart->effector) + 1);
+        chart_cache_write_section(file, header.illustrator_offset, chart->illustrator, strlen(chart->illustrator) + 1);
+
+        chart_cache_write_section(file, header.beats.offset, chart->beats, chart->num_beats * sizeof(Beat));
+        chart_cache_write_section(file, header.tempos.offset, chart->tempos, chart->num_tempos * sizeof(Tempo));
+
+        for (int i = 0; i < CHART_BT_LANES; i++)
+            chart_cache_write_section(file, header.bt_notes[i].offset, chart->bt_notes[i], chart->num_bt_notes[i] * sizeof(Note));
+
+        for (int i = 0; i < CHART_FX_LANES; i++)
+            chart_cache_write_section(file, header.fx_notes[i].offset, chart->fx_notes[i], chart->num_fx_notes[i] * sizeof(Note));
+
+        for (int l = 0; l < CHART_ANALOG_LANES; l++)
+        {
+            chart_cache_write_section(file, header.analogs[l].offset, analogs[l], chart->num_analogs[l] * sizeof(ChartCacheAnalog));
+            chart_cache_write_section(file, header.analog_points[l].offset, chart->analog_points[l], chart->num_analog_points[l] * sizeof(AnalogPoint));
+        }
+
+        // only replace the cache if everything was written
+        bool failed = ferror(file);
+        failed |= fclose(file) != 0;
+
+        if (failed || rename(temporary_path, path) != 0)
+        {
+            printf("chart_cache_write: unable to write cache '%s'\n", path);
+            unlink(temporary_path);
+        }
+    }
+    else
+        printf("chart_cache_write: unable to write cache '%s'\n", path);
+
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+        free(analogs[l]);
+}
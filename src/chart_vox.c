@@ -7,12 +7,13 @@
 
 #include "note_utils.h"
 
-void *chart_vox_parsing_state_create()
+void *chart_vox_parsing_state_create(bool counting)
 {
     // create the parsing state
     VoxParsingState *state = malloc(sizeof(VoxParsingState));
 
     // set the default section to none
+    state->counting = counting;
     state->section = VoxSectionNone;
 
     // default the building analogs to null
@@ -32,118 +33,322 @@ void chart_vox_parsing_state_free(void *parsing_state)
     free(state);
 }
 
-bool has_prefix(const char *prefix, const char *string)
+// the names of every non-track section, checked in order
+// numerous early vox files have the "END POSISION" typo
+static const VoxSectionName section_names[] =
+{
+    { "FORMAT VERSION", 14, VoxSectionFormatVersion },
+    { "END POSITION",   12, VoxSectionEndPosition },
+    { "END POSISION",   12, VoxSectionEndPosition },
+    { "BEAT INFO",       9, VoxSectionBeatInfo },
+    { "BPM INFO",        8, VoxSectionBpmInfo },
+    { "END",             3, VoxSectionNone },
+};
+
+// the section for each track number, "TRACK[n]" or "TRACK[n] START"
+// index 0 is unused as tracks are numbered starting at 1
+static const VoxSection track_sections[VOX_TRACK_NUMBER_MAX + 1] =
+{
+    VoxSectionNone,
+    VoxSectionTrackAnalogL, //TRACK1
+    VoxSectionTrackFxL,     //TRACK2
+    VoxSectionTrackBtA,     //TRACK3
+    VoxSectionTrackBtB,     //TRACK4
+    VoxSectionTrackBtC,     //TRACK5
+    VoxSectionTrackBtD,     //TRACK6
+    VoxSectionTrackFxR,     //TRACK7
+    VoxSectionTrackAnalogR, //TRACK8
+};
+
+// lines that are always skipped
+// some old vox files have "sections" that are actually comments
+static const char *ignored_lines[] =
+{
+    "#====================================",
+    "#ITEM",
+    "#LINE",
+    "#SONG",
+    "# SOUND VOLTEX OUTPUT TEXT FILE",
+    "# TRACK INFO",
+};
+
+bool has_prefix(const char *prefix, size_t prefix_length, const char *string, const char *string_end)
 {
     // return whether or not the given string has the given prefix
-    return strncmp(prefix, string, strlen(prefix)) == 0;
+    return string_end - string >= prefix_length && memcmp(prefix, string, prefix_length) == 0;
 }
 
-uint8_t data_line_values(char *line, char *values[VOX_DATA_LINE_MAX_VALUES])
+bool equals(const char *value, size_t value_length, const char *string, const char *string_end)
 {
-    // data lines in vox have values separated by tab characters
+    // return whether or not the given string is exactly the given value
+    return string_end - string == value_length && memcmp(value, string, value_length) == 0;
+}
+
+int parse_int(const char **cursor, const char *end)
+{
+    // parse a base 10 integer from cursor, moving cursor to the first character after it
+    const char *c = *cursor;
+    bool negative = false;
+    int value = 0;
+
+    if (c < end && (*c == '-' || *c == '+'))
+    {
+        negative = *c == '-';
+        c++;
+    }
+
+    while (c < end && *c >= '0' && *c <= '9')
+    {
+        value = value * 10 + (*c - '0');
+        c++;
+    }
+
+    *cursor = c;
+    return negative ? -value : value;
+}
+
+double parse_double(const char **cursor, const char *end)
+{
+    // parse a base 10 decimal number from cursor, moving cursor to the first character after it
+    // vox numbers are only ever plain decimals, e.g. "177.0000", so no exponents are handled
+    const char *c = *cursor;
+    bool negative = false;
+    double value = 0;
+
+    if (c < end && (*c == '-' || *c == '+'))
+    {
+        negative = *c == '-';
+        c++;
+    }
+
+    while (c < end && *c >= '0' && *c <= '9')
+    {
+        value = value * 10 + (*c - '0');
+        c++;
+    }
+
+    if (c < end && *c == '.')
+    {
+        c++;
 
-    // get the first value
-    char *last_value = strtok(line, "\t");
+        // accumulate the fraction as an integer and divide once to avoid compounding rounding errors
+        double fraction = 0;
+        double divisor = 1;
+
+        while (c < end && *c >= '0' && *c <= '9')
+        {
+            fraction = fraction * 10 + (*c - '0');
+            divisor *= 10;
+            c++;
+        }
+
+        value += fraction / divisor;
+    }
+
+    *cursor = c;
+    return negative ? -value : value;
+}
+
+int value_int(VoxValue *value)
+{
+    // return the given value parsed as an integer
+    const char *cursor = value->start;
+    return parse_int(&cursor, value->end);
+}
+
+double value_double(VoxValue *value)
+{
+    // return the given value parsed as a decimal
+    const char *cursor = value->start;
+    return parse_double(&cursor, value->end);
+}
+
+uint8_t data_line_values(const char *line, const char *line_end, VoxValue values[VOX_DATA_LINE_MAX_VALUES])
+{
+    // data lines in vox have values separated by tab characters
     uint8_t num_values = 0;
+    const char *cursor = line;
 
-    while (last_value)
+    while (cursor < line_end && num_values < VOX_DATA_LINE_MAX_VALUES)
     {
-        // increment the number of values
-        num_values++;
+        // find the end of the current value
+        const char *value_end = memchr(cursor, '\t', line_end - cursor);
+        if (!value_end)
+            value_end = line_end;
 
-        // append the current value to values
-        values[num_values - 1] = last_value;
+        // append the current value to values, skipping empty values like strtok did
+        if (value_end > cursor)
+        {
+            values[num_values] = (VoxValue){ cursor, value_end };
+            num_values++;
+        }
 
-        // get the next value
-        last_value = strtok(NULL, "\t");
+        // move past the tab
+        cursor = value_end + 1;
     }
 
     // return the number of values
     return num_values;
 }
 
-bool is_track_section(const char *section_name, uint8_t number)
+void parse_section(VoxParsingState *state, const char *name, const char *name_end)
 {
+    // check the fixed section names
+    for (int i = 0; i < sizeof(section_names) / sizeof(section_names[0]); i++)
+    {
+        if (equals(section_names[i].name, section_names[i].length, name, name_end))
+        {
+            state->section = section_names[i].section;
+            return;
+        }
+    }
+
     // track sections can be named either "TRACK[n]" or "TRACK[n] START"
-    // these values are always the same size
-    char track[7];
-    char track_start[13];
+    if (has_prefix("TRACK", 5, name, name_end) && name_end - name >= 6)
+    {
+        int number = name[5] - '0';
+        const char *suffix = name + 6;
 
-    // format the track strings and set the respective values
-    sprintf(track, "TRACK%i", number);
-    sprintf(track_start, "%s START", track);
+        if (number >= 1 && number <= VOX_TRACK_NUMBER_MAX &&
+            (suffix == name_end || equals(" START", 6, suffix, name_end)))
+        {
+            state->section = track_sections[number];
+            return;
+        }
+    }
 
-    // return whether the section name matches one of the track section formats
-    return strcmp(section_name, track) == 0 ||
-           strcmp(section_name, track_start) == 0;
+    // print out unhandled sections for debugging, once per chart
+    if (!state->counting)
+        printf("parse_section: unhandled section '%.*s'\n", (int)(name_end - name), name);
 }
 
-void parse_section(VoxParsingState *state, char *name)
+void parse_timing(VoxValue *value, uint16_t *measure, uint8_t *beat, uint8_t *subbeat)
 {
-    // format version
-    if (strcmp(name, "FORMAT VERSION") == 0)
-        state->section = VoxSectionFormatVersion;
-    // end position
-    // numerous early vox files have this typo
-    else if (strcmp(name, "END POSITION") == 0 ||
-             strcmp(name, "END POSISION") == 0)
-        state->section = VoxSectionEndPosition;
-    // beat info
-    else if (strcmp(name, "BEAT INFO") == 0)
-        state->section = VoxSectionBeatInfo;
-    // bpm info
-    else if (strcmp(name, "BPM INFO") == 0)
-        state->section = VoxSectionBpmInfo;
-    // analog l
-    else if (is_track_section(name, 1))
-        state->section = VoxSectionTrackAnalogL;
-    // analog r
-    else if (is_track_section(name, 8))
-        state->section = VoxSectionTrackAnalogR;
-    // bt a
-    else if (is_track_section(name, 3))
-        state->section = VoxSectionTrackBtA;
-    // bt b
-    else if (is_track_section(name, 4))
-        state->section = VoxSectionTrackBtB;
-    // bt c
-    else if (is_track_section(name, 5))
-        state->section = VoxSectionTrackBtC;
-    // bt d
-    else if (is_track_section(name, 6))
-        state->section = VoxSectionTrackBtD;
-    // fx l
-    else if (is_track_section(name, 2))
-        state->section = VoxSectionTrackFxL;
-    // fx r
-    else if (is_track_section(name, 7))
-        state->section = VoxSectionTrackFxR;
-    // end section
-    else if (strcmp(name, "END") == 0)
-        state->section = VoxSectionNone;
-    // print out unhandled sections for debugging
-    else
-        printf("parse_section: unhandled section '%s'\n", name);
+    // timing is formatted as "measure,beat,subbeat"
+    // measure and beat are numbered starting at 1 in vox, but 0 in vvd
+    const char *cursor = value->start;
+
+    *measure = parse_int(&cursor, value->end) - 1;
+    cursor++;
+    *beat = parse_int(&cursor, value->end) - 1;
+    cursor++;
+    *subbeat = parse_int(&cursor, value->end);
 }
 
-void parse_timing(char *value, uint16_t *measure, uint8_t *beat, uint8_t *subbeat)
+int section_analog_lane(VoxSection section)
 {
-    // measure and beat are numbered starting at 1 in vox, but 0 in vvd
-    *measure = atoi(strtok(value, ",")) - 1;
-    *beat = atoi(strtok(NULL, ",")) - 1;
-    *subbeat = atoi(strtok(NULL, ","));
+    // return the analog lane for the given analog track section
+    assert(section == VoxSectionTrackAnalogL || section == VoxSectionTrackAnalogR);
+    return (section == VoxSectionTrackAnalogL) ? CHART_ANALOG_LANE_L : CHART_ANALOG_LANE_R;
 }
 
-void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
+void section_notes(Chart *chart, VoxSection section, int **num_notes, Note **notes)
+{
+    // get the respective notes and num_notes values for the given bt/fx track section
+    switch (section)
+    {
+        case VoxSectionTrackBtA:
+            *num_notes = &chart->num_bt_notes[CHART_BT_LANE_A];
+            *notes = chart->bt_notes[CHART_BT_LANE_A];
+            break;
+        case VoxSectionTrackBtB:
+            *num_notes = &chart->num_bt_notes[CHART_BT_LANE_B];
+            *notes = chart->bt_notes[CHART_BT_LANE_B];
+            break;
+        case VoxSectionTrackBtC:
+            *num_notes = &chart->num_bt_notes[CHART_BT_LANE_C];
+            *notes = chart->bt_notes[CHART_BT_LANE_C];
+            break;
+        case VoxSectionTrackBtD:
+            *num_notes = &chart->num_bt_notes[CHART_BT_LANE_D];
+            *notes = chart->bt_notes[CHART_BT_LANE_D];
+            break;
+        case VoxSectionTrackFxL:
+            *num_notes = &chart->num_fx_notes[CHART_FX_LANE_L];
+            *notes = chart->fx_notes[CHART_FX_LANE_L];
+            break;
+        case VoxSectionTrackFxR:
+            *num_notes = &chart->num_fx_notes[CHART_FX_LANE_R];
+            *notes = chart->fx_notes[CHART_FX_LANE_R];
+            break;
+        default:
+            assert(false);
+    }
+}
+
+bool analog_point_state_valid(int point_state)
+{
+    // some vox have invalid point states, which are ignored
+    return point_state == VoxAnalogStateContinue ||
+           point_state == VoxAnalogStateStart ||
+           point_state == VoxAnalogStateEnd;
+}
+
+void count_data_line(Chart *chart, VoxParsingState *state, VoxValue values[VOX_DATA_LINE_MAX_VALUES], uint8_t num_values)
+{
+    // count the value that the given line would add to the given chart in the filling pass
+    switch (state->section)
+    {
+        case VoxSectionBeatInfo:
+            chart->num_beats++;
+            break;
+        case VoxSectionBpmInfo:
+            chart->num_tempos++;
+            break;
+        case VoxSectionTrackAnalogL:
+        case VoxSectionTrackAnalogR:
+        {
+            // ignore invalid points the same as the filling pass
+            if (num_values < 3)
+                break;
+
+            int point_state = value_int(&values[2]);
+            if (!analog_point_state_valid(point_state))
+                break;
+
+            // every start point starts a new analog
+            int lane = section_analog_lane(state->section);
+            if (point_state == VoxAnalogStateStart)
+                chart->num_analogs[lane]++;
+
+            chart->num_analog_points[lane]++;
+            break;
+        }
+        case VoxSectionTrackBtA:
+        case VoxSectionTrackBtB:
+        case VoxSectionTrackBtC:
+        case VoxSectionTrackBtD:
+        case VoxSectionTrackFxL:
+        case VoxSectionTrackFxR:
+        {
+            int *num_notes;
+            Note *notes;
+            section_notes(chart, state->section, &num_notes, &notes);
+
+            *num_notes += 1;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void parse_data_line(Chart *chart, VoxParsingState *state, const char *line, const char *line_end)
 {
     // get the values for the line, as most sections use them
-    char *values[VOX_DATA_LINE_MAX_VALUES];
-    uint8_t num_values = data_line_values(line, values);
+    VoxValue values[VOX_DATA_LINE_MAX_VALUES];
+    uint8_t num_values = data_line_values(line, line_end, values);
 
-    if (state->section == VoxSectionFormatVersion)
+    if (state->counting)
+    {
+        // only count values in the counting pass
+        count_data_line(chart, state, values, num_values);
+    }
+    else if (state->section == VoxSectionFormatVersion)
     {
         // format versions are just a single integer
-        state->format_version = atoi(line);
+        const char *cursor = line;
+        state->format_version = parse_int(&cursor, line_end);
     }
     else if (state->section != VoxSectionNone)
     {
@@ -153,7 +358,7 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
         uint8_t subbeat;
 
         // parse the timing for the current line
-        parse_timing(values[0], &measure, &beat, &subbeat);
+        parse_timing(&values[0], &measure, &beat, &subbeat);
 
         switch (state->section)
         {
@@ -165,7 +370,7 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 // set the charts end timing
                 chart->num_measures = measure;
                 chart->end_subbeat = note_time_to_subbeat(chart, measure, beat, subbeat);
-                chart->end_time = subbeat_at_tempo_to_time(&chart->tempos[chart->num_tempos - 1], chart->end_subbeat);
+                chart->end_time = subbeat_to_time(chart, chart->end_subbeat);
 
                 break;
             }
@@ -177,8 +382,8 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 // create the beat
                 Beat chart_beat = (Beat)
                 {
-                    .numerator = atoi(values[1]),
-                    .denominator = atoi(values[2]),
+                    .numerator = value_int(&values[1]),
+                    .denominator = value_int(&values[2]),
                     .measure = measure,
                     .subbeat = subbeat,
                 };
@@ -211,7 +416,7 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 assert(num_values == 3);
 
                 // add the tempo to the given chart
-                chart_add_tempo(chart, atof(values[1]), note_time_to_subbeat(chart, measure, beat, subbeat));
+                chart_add_tempo(chart, value_double(&values[1]), note_time_to_subbeat(chart, measure, beat, subbeat));
 
                 break;
             }
@@ -237,25 +442,14 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 assert(num_values == 5 || num_values == 6 || num_values == 7);
 
                 // get this points state
-                int point_state = atoi(values[2]);
+                int point_state = value_int(&values[2]);
 
                 // some vox have invalid point states, ignore those
-                if (point_state != VoxAnalogStateContinue &&
-                    point_state != VoxAnalogStateStart &&
-                    point_state != VoxAnalogStateEnd)
+                if (!analog_point_state_valid(point_state))
                     return;
 
                 // get the respective lane for the current section
-                int lane;
-                switch (state->section)
-                {
-                    case VoxSectionTrackAnalogL:
-                        lane = CHART_ANALOG_LANE_L;
-                        break;
-                    case VoxSectionTrackAnalogR:
-                        lane = CHART_ANALOG_LANE_R;
-                        break;
-                }
+                int lane = section_analog_lane(state->section);
 
                 // start an analog if this is a start point
                 if (point_state == VoxAnalogStateStart)
@@ -263,10 +457,11 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                     // assert that there is not already an analog being built
                     assert(!state->building_analogs[lane]);
 
-                    // create a new analog and set the building analog to it
-                    Analog *analog = malloc(sizeof(Analog));
+                    // start building the next analog of the lane
+                    // its points start at the end of the lanes points, as points are only appended to the building analog
+                    Analog *analog = &chart->analogs[lane][chart->num_analogs[lane]];
                     analog->num_points = 0;
-                    analog->points = malloc(CHART_ANALOG_POINTS_MAX * sizeof(AnalogPoint));
+                    analog->points = &chart->analog_points[lane][chart->num_analog_points[lane]];
                     state->building_analogs[lane] = analog;
                 }
 
@@ -277,23 +472,13 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 AnalogPoint point = (AnalogPoint)
                 {
                     .subbeat = note_time_to_subbeat(chart, measure, beat, subbeat),
-                    .position = atoi(values[1]) / 127.0, //position is on a scale of 0 to 127
-                    .position_scale = (num_values >= 6) ? atof(values[5]) : 1,
+                    .position = value_int(&values[1]) / 127.0, //position is on a scale of 0 to 127
+                    .position_scale = (num_values >= 6) ? value_double(&values[5]) : 1,
                     .slam = false,
                 };
 
-                // get the tempo of the point
-                Tempo *tempo;
-                for (int i = 0; i < chart->num_tempos; i++)
-                {
-                    if (chart->tempos[i].subbeat > point.subbeat)
-                        break;
-
-                    tempo = &chart->tempos[i];
-                }
-
                 // set the points time
-                point.time = subbeat_at_tempo_to_time(tempo, point.subbeat);
+                point.time = subbeat_to_time(chart, point.subbeat);
 
                 // set whether or not the current point is a slam
                 if (state->building_analogs[lane]->num_points > 0)
@@ -305,27 +490,16 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 // get the current building analog
                 Analog *analog = state->building_analogs[lane];
 
-                // resize the analogs points if the next point is going to exceed its allocated size
-                int before_size = (analog->num_points / CHART_ANALOG_POINTS_MAX) + 1;
-                int after_size = ((analog->num_points + 1) / CHART_ANALOG_POINTS_MAX) + 1;
-
-                if (after_size > before_size)
-                    analog->points = realloc(analog->points, after_size * CHART_ANALOG_POINTS_MAX * sizeof(AnalogPoint));
-
                 // add the current point to the building analog
                 analog->points[analog->num_points] = point;
                 analog->num_points += 1;
+                chart->num_analog_points[lane] += 1;
 
                 // end the current analog if this is an end point
                 if (point_state == VoxAnalogStateEnd)
                 {
-                    // pop the current analog into the charts analogs
-                    Analog *analog = state->building_analogs[lane];
-                    chart->analogs[lane][chart->num_analogs[lane]] = *analog;
+                    // add the finished analog to the charts analogs
                     chart->num_analogs[lane] += 1;
-
-                    // free the now finished analog
-                    free(analog);
                     state->building_analogs[lane] = NULL;
                 }
 
@@ -344,34 +518,7 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 // get the respective notes and num_notes values
                 int *num_notes;
                 Note *notes;
-
-                switch (state->section)
-                {
-                    case VoxSectionTrackBtA:
-                        num_notes = &chart->num_bt_notes[CHART_BT_LANE_A];
-                        notes = chart->bt_notes[CHART_BT_LANE_A];
-                        break;
-                    case VoxSectionTrackBtB:
-                        num_notes = &chart->num_bt_notes[CHART_BT_LANE_B];
-                        notes = chart->bt_notes[CHART_BT_LANE_B];
-                        break;
-                    case VoxSectionTrackBtC:
-                        num_notes = &chart->num_bt_notes[CHART_BT_LANE_C];
-                        notes = chart->bt_notes[CHART_BT_LANE_C];
-                        break;
-                    case VoxSectionTrackBtD:
-                        num_notes = &chart->num_bt_notes[CHART_BT_LANE_D];
-                        notes = chart->bt_notes[CHART_BT_LANE_D];
-                        break;
-                    case VoxSectionTrackFxL:
-                        num_notes = &chart->num_fx_notes[CHART_FX_LANE_L];
-                        notes = chart->fx_notes[CHART_FX_LANE_L];
-                        break;
-                    case VoxSectionTrackFxR:
-                        num_notes = &chart->num_fx_notes[CHART_FX_LANE_R];
-                        notes = chart->fx_notes[CHART_FX_LANE_R];
-                        break;
-                }
+                section_notes(chart, state->section, &num_notes, &notes);
 
                 // create the note
                 Note note = (Note)
@@ -380,26 +527,19 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
                 };
 
                 // set the hold properties if this note is a hold
-                int length = atoi(values[1]);
+                int length = value_int(&values[1]);
                 if (length > 0)
                 {
                     note.hold = true;
                     note.end_subbeat = note.start_subbeat + length;
                 }
 
-                // get the tempo of the note
-                Tempo *tempo;
-                for (int i = 0; i < chart->num_tempos; i++)
-                {
-                    if (chart->tempos[i].subbeat > note.start_subbeat)
-                        break;
-
-                    tempo = &chart->tempos[i];
-                }
-
                 // set the notes start and end times
-                note.start_time = subbeat_at_tempo_to_time(tempo, note.start_subbeat);
-                note.end_time = subbeat_at_tempo_to_time(tempo, note.end_subbeat);
+                // the end time is found separately as holds can span tempo changes
+                note.start_time = subbeat_to_time(chart, note.start_subbeat);
+
+                if (note.hold)
+                    note.end_time = subbeat_to_time(chart, note.end_subbeat);
 
                 // append the note to the charts notes
                 notes[*num_notes] = note;
@@ -411,30 +551,28 @@ void parse_data_line(Chart *chart, VoxParsingState *state, char *line)
     }
 }
 
-void chart_vox_parse_line(Chart *chart, void *parsing_state, char *line)
+void chart_vox_parse_line(Chart *chart, void *parsing_state, const char *line, const char *line_end)
 {
     VoxParsingState *state = (VoxParsingState *)parsing_state;
 
     // ignore comment and blank lines
-    // some old vox files have "sections" that are actually comments
-    if (has_prefix("//", line) ||
-        strcmp(line, "") == 0 ||
-        strcmp(line, "#====================================") == 0 ||
-        strcmp(line, "#ITEM") == 0 ||
-        strcmp(line, "#LINE") == 0 ||
-        strcmp(line, "#SONG") == 0 ||
-        strcmp(line, "# SOUND VOLTEX OUTPUT TEXT FILE") == 0 ||
-        strcmp(line, "# TRACK INFO") == 0)
+    if (line == line_end || has_prefix("//", 2, line, line_end))
         return;
 
-    if (has_prefix("#", line))
+    if (*line == '#')
     {
+        // ignore lines that look like sections but are comments
+        // only checked here as every ignored line starts with a #
+        for (int i = 0; i < sizeof(ignored_lines) / sizeof(ignored_lines[0]); i++)
+            if (equals(ignored_lines[i], strlen(ignored_lines[i]), line, line_end))
+                return;
+
         // parse the section name, which is everything after the #
-        parse_section(state, line + 1);
+        parse_section(state, line + 1, line_end);
     }
     else
     {
         // all other non-empty and non-comment lines are data
-        parse_data_line(chart, state, line);
+        parse_data_line(chart, state, line, line_end);
     }
 }
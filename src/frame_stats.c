@@ -0,0 +1,180 @@
+#include "frame_stats.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+int histogram_bucket(int64_t duration)
+{
+    // durations are bucketed by microsecond
+    uint64_t value = (duration > 0) ? duration / 1000 : 0;
+
+    // get the power of two range of the value
+    // each range past the first is shifted down until it fits in FRAME_STATS_SUB_BUCKETS * 2
+    int shift = 0;
+    while ((value >> shift) >= FRAME_STATS_SUB_BUCKETS * 2)
+        shift++;
+
+    // record durations past the last range in its last bucket
+    if (shift > FRAME_STATS_MAX_SHIFT)
+        return FRAME_STATS_BUCKETS - 1;
+
+    return shift * FRAME_STATS_SUB_BUCKETS + (value >> shift);
+}
+
+int64_t bucket_highest_duration(int bucket)
+{
+    // get the range and offset within it of the given bucket
+    int shift = (bucket < FRAME_STATS_SUB_BUCKETS * 2) ? 0 : bucket / FRAME_STATS_SUB_BUCKETS - 1;
+    uint64_t value = bucket - shift * FRAME_STATS_SUB_BUCKETS;
+
+    // get the highest microsecond in the bucket, in nanoseconds
+    return (int64_t)(((value + 1) << shift) - 1) * 1000;
+}
+
+void histogram_record(FrameStatsHistogram *histogram, int64_t duration)
+{
+    histogram->counts[histogram_bucket(duration)]++;
+
+    if (histogram->count == 0 || duration < histogram->min)
+        histogram->min = duration;
+
+    if (histogram->count == 0 || duration > histogram->max)
+        histogram->max = duration;
+
+    histogram->count++;
+}
+
+FrameStats *frame_stats_create()
+{
+    // create the stats, zeroed so every histogram is empty
+    FrameStats *stats = calloc(1, sizeof(FrameStats));
+    return stats;
+}
+
+void frame_stats_free(FrameStats *stats)
+{
+    free(stats);
+}
+
+void frame_stats_record(FrameStats *stats, int64_t update_duration, int64_t draw_duration, double chart_time)
+{
+    stats->current_update = update_duration;
+    stats->current_draw = draw_duration;
+    stats->current_chart_time = chart_time;
+}
+
+void frame_stats_end_frame(FrameStats *stats, int64_t swap_duration)
+{
+    int64_t now = time_nanoseconds();
+
+    histogram_record(&stats->update, stats->current_update);
+    histogram_record(&stats->draw, stats->current_draw);
+    histogram_record(&stats->swap, swap_duration);
+
+    // the first frame has no previous frame to be late after
+    if (stats->last_frame_end != 0)
+    {
+        int64_t duration = now - stats->last_frame_end;
+        histogram_record(&stats->frame, duration);
+
+        // keep the frame if it was late
+        if (duration > FRAME_STATS_LATE_THRESHOLD)
+        {
+            if (stats->num_late_frames < FRAME_STATS_MAX_LATE_FRAMES)
+            {
+                stats->late_frames[stats->num_late_frames] = (FrameStatsLateFrame)
+                {
+                    .chart_time = stats->current_chart_time,
+                    .duration = duration,
+                };
+            }
+
+            stats->num_late_frames++;
+        }
+    }
+
+    // start the next frame
+    stats->last_frame_end = now;
+    stats->current_update = 0;
+    stats->current_draw = 0;
+}
+
+int64_t frame_stats_percentile(FrameStatsHistogram *histogram, double percentage)
+{
+    if (histogram->count == 0)
+        return 0;
+
+    // get the number of durations that must be at or below the result
+    uint32_t target = ceil(histogram->count * percentage / 100.0);
+    if (target < 1)
+        target = 1;
+
+    // find the bucket containing the target duration
+    // the result is clamped to max, as the bucket may extend past it
+    uint32_t total = 0;
+    for (int i = 0; i < FRAME_STATS_BUCKETS; i++)
+    {
+        total += histogram->counts[i];
+        if (total >= target)
+        {
+            int64_t duration = bucket_highest_duration(i);
+            return (duration < histogram->max) ? duration : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+void write_histogram(FrameStatsHistogram *histogram, const char *name, FILE *file)
+{
+    fprintf(file,
+            "%-8s %8u %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+            name,
+            histogram->count,
+            time_nanoseconds_to_milliseconds(histogram->min),
+            time_nanoseconds_to_milliseconds(frame_stats_percentile(histogram, 50)),
+            time_nanoseconds_to_milliseconds(frame_stats_percentile(histogram, 90)),
+            time_nanoseconds_to_milliseconds(frame_stats_percentile(histogram, 99)),
+            time_nanoseconds_to_milliseconds(frame_stats_percentile(histogram, 99.9)),
+            time_nanoseconds_to_milliseconds(histogram->max));
+}
+
+void frame_stats_write_report(FrameStats *stats, FILE *file)
+{
+    // write the histograms
+    fprintf(file, "%-8s %8s %9s %9s %9s %9s %9s %9s\n", "ms", "count", "min", "p50", "p90", "p99", "p99.9", "max");
+    write_histogram(&stats->update, "update", file);
+    write_histogram(&stats->draw, "draw", file);
+    write_histogram(&stats->swap, "swap", file);
+    write_histogram(&stats->frame, "frame", file);
+
+    // write the late frames
+    fprintf(file,
+            "%i of %u frames were late, taking over %.3f ms\n",
+            stats->num_late_frames,
+            stats->frame.count,
+            time_nanoseconds_to_milliseconds(FRAME_STATS_LATE_THRESHOLD));
+
+    int num_kept = (stats->num_late_frames < FRAME_STATS_MAX_LATE_FRAMES) ? stats->num_late_frames : FRAME_STATS_MAX_LATE_FRAMES;
+    for (int i = 0; i < num_kept; i++)
+    {
+        fprintf(file,
+                "late at %.3f ms, took %.3f ms\n",
+                stats->late_frames[i].chart_time,
+                time_nanoseconds_to_milliseconds(stats->late_frames[i].duration));
+    }
+
+    if (num_kept < stats->num_late_frames)
+        fprintf(file, "%i more late frames were not kept\n", stats->num_late_frames - num_kept);
+}
+
+bool frame_stats_write(FrameStats *stats, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    frame_stats_write_report(stats, file);
+    fclose(file);
+    return true;
+}
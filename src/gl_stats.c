@@ -0,0 +1,79 @@
+#include "gl_stats.h"
+
+// the stats of the current and last finished frames
+static GLStats current_stats;
+static GLStats last_stats;
+
+// the file to write the stats of each frame to, if any, and the number of the current frame
+static FILE *csv_file;
+static int frame;
+
+void gl_stats_count_draw(GLsizei vertices)
+{
+    current_stats.draw_calls++;
+    current_stats.vertices += vertices;
+}
+
+void gl_stats_count_indexed_draw(GLsizei indices)
+{
+    current_stats.draw_calls++;
+    current_stats.indices += indices;
+}
+
+void gl_stats_count_uniform()
+{
+    current_stats.uniform_uploads++;
+}
+
+void gl_stats_count_buffer_upload(GLsizeiptr size)
+{
+    current_stats.buffer_uploads++;
+    current_stats.buffer_upload_bytes += size;
+}
+
+void gl_stats_count_program_switch()
+{
+    current_stats.program_switches++;
+}
+
+void gl_stats_count_blend_change()
+{
+    current_stats.blend_changes++;
+}
+
+void gl_stats_end_frame()
+{
+    // write the finished frame if there is a csv file
+    if (csv_file)
+    {
+        fprintf(csv_file,
+                "%i,%i,%i,%i,%i,%i,%li,%i,%i\n",
+                frame,
+                current_stats.draw_calls,
+                current_stats.vertices,
+                current_stats.indices,
+                current_stats.uniform_uploads,
+                current_stats.buffer_uploads,
+                current_stats.buffer_upload_bytes,
+                current_stats.program_switches,
+                current_stats.blend_changes);
+    }
+
+    // start the next frame
+    last_stats = current_stats;
+    current_stats = (GLStats){ 0 };
+    frame++;
+}
+
+GLStats gl_stats_last_frame()
+{
+    return last_stats;
+}
+
+void gl_stats_set_csv(FILE *file)
+{
+    csv_file = file;
+
+    if (csv_file)
+        fprintf(csv_file, "frame,draw_calls,vertices,indices,uniform_uploads,buffer_uploads,buffer_upload_bytes,program_switches,blend_changes\n");
+}
@@ -12,8 +12,10 @@
 #include <linux/hidraw.h>
 #include <sys/ioctl.h>
 
+#include "profile.h"
+#include "trace.h"
+
 // max values
-#define HID_MAX_BUFFER                 65
 #define HID_DEVICE_MAX_IO              256
 #define HID_DEVICE_MAX_REQUEST_GROUPS  64
 #define HID_REQUEST_GROUP_MAX_REQUESTS 64
@@ -277,13 +279,19 @@ void hid_device_set_io(HIDDevice *device)
 // Get the first HIDDevice matching the given Vendor ID and Product ID.
 HIDDevice *hid_device_get(uint16_t vendor_id, uint16_t product_id)
 {
+    int profile_phase = profile_begin("hid_device_get");
+
     // create the device
     HIDDevice *device = malloc(sizeof(HIDDevice));
 
     // set the devices values
+    // finding the devnode enumerates every hidraw device through udev, so it is profiled on its own
     device->vendor_id = vendor_id;
     device->product_id = product_id;
+
+    int devnode_profile_phase = profile_begin("hid_device_set_devnode_path");
     hid_device_set_devnode_path(device);
+    profile_end(devnode_profile_phase);
 
     // open the device and set its io
     hid_device_open(device);
@@ -292,6 +300,8 @@ HIDDevice *hid_device_get(uint16_t vendor_id, uint16_t product_id)
     // allocate the request groups array
     device->request_groups = malloc(HID_DEVICE_MAX_REQUEST_GROUPS * sizeof(HIDRequestGroup));
 
+    profile_end(profile_phase);
+
     // return the device
     return device;
 }
@@ -434,9 +444,74 @@ void hid_device_set_light(HIDDevice *device, int index, bool on)
                            on ? &light->logical_maximum : &light->logical_minimum);
 }
 
+// Get the offset, in bytes, from the beginning of a report buffer for the given HIDIO's value to be read from/written to.
+int hid_io_offset(HIDIO *io)
+{
+    // + 1 for the report id
+    return 1 + (io->report_offset + io->report_size) / 8;
+}
+
+// Decode the value of the given axis HIDIO from the given report buffer.
+float hid_io_decode_axis(HIDIO *io, const char *buffer)
+{
+    // some devices like to not abide by the logical min/max they report, so force them to
+    int8_t capped_value = buffer[hid_io_offset(io)];
+    capped_value = capped_value < io->logical_minimum ? io->logical_minimum : capped_value;
+    capped_value = capped_value > io->logical_maximum ? io->logical_maximum : capped_value;
+
+    // store commonly used values
+    int8_t min = io->logical_minimum, max = io->logical_maximum;
+
+    // handle negative logical minimums
+    if (min < 0)
+        return (float)(capped_value + -min) / (float)(max + -min);
+    else
+        return (float)(capped_value - min) / (float)(max - min);
+}
+
+// Decode the value of the given button HIDIO from the given report buffer.
+bool hid_io_decode_button(HIDIO *io, const char *buffer)
+{
+    // get bit io->report_offset of the buttons byte
+    return (buffer[hid_io_offset(io)] >> io->report_offset) & 1;
+}
+
+// Read the next unread report of the given device into buffer.
+// Returns the size of the report read, 0 if there are no unread reports, or -1 if reading failed.
+int hid_device_read_report(HIDDevice *device, char *buffer, int size)
+{
+    int result = read(device->fd, buffer, size);
+
+    // the EAGAIN error (resource temporarily unavailable) is set when there is no more data to read
+    if (result == -1 && errno == EAGAIN)
+        return 0;
+
+    // any other error is returned to the caller, as it happens when the device is unplugged
+    if (result == -1)
+        perror("reading hid report");
+
+    return result;
+}
+
+// Get the value of the axis at the given index from the given report of the given device.
+float hid_device_report_axis(HIDDevice *device, const char *report, int index)
+{
+    assert(index < device->num_axes);
+    return hid_io_decode_axis(&device->axes[index], report);
+}
+
+// Get the state of the button at the given index from the given report of the given device.
+bool hid_device_report_button(HIDDevice *device, const char *report, int index)
+{
+    assert(index < device->num_buttons);
+    return hid_io_decode_button(&device->buttons[index], report);
+}
+
 // Process and clear out the given devices requests.
 void hid_device_update(HIDDevice *device)
 {
+    trace_begin("hid_device_update");
+
     // iterate the devices request groups
     for (int rgi = 0; rgi < device->num_request_groups; rgi++)
     {
@@ -457,16 +532,7 @@ void hid_device_update(HIDDevice *device)
             // read all the unread results
             // this is necessary as multiple reports can occur during a frame
             // so when the device tries to update it will be behind on reports
-            while(1)
-            {
-                int result = read(device->fd, buffer, report_size);
-
-                // the EAGAIN error (resource temporarily unavailable) is set when there is no more data to read
-                if (result == -1 && errno == EAGAIN)
-                    break;
-
-                assert_result(result, "reading hid report");
-            }
+            while (hid_device_read_report(device, buffer, report_size) > 0);
         }
 
         // iterate the request groups requests
@@ -488,41 +554,21 @@ void hid_device_update(HIDDevice *device)
                     break;
             }
 
-            // the offset, in bytes, from the beginning of the buffer for values to be read from/written to
-            // + 1 for the report id
-            int offset = 1 + (io->report_offset + io->report_size) / 8;
-
             switch (request->type)
             {
                 case HID_REQUEST_AXIS:
-                {
-                    // some devices like to not abide by the logical min/max they report, so force them to
-                    int8_t capped_value = buffer[offset];
-                    capped_value = capped_value < io->logical_minimum ? io->logical_minimum : capped_value;
-                    capped_value = capped_value > io->logical_maximum ? io->logical_maximum : capped_value;
-
-                    // store commonly used values
-                    int8_t min = io->logical_minimum, max = io->logical_maximum;
-                    float value;
-
-                    // handle negative logical minimums
-                    if (min < 0)
-                        value = (float)(capped_value + -min) / (float)(max + -min);
-                    else
-                        value = (float)(capped_value - min) / (float)(max - min);
-
-                    // set the value
-                    *(float *)request->value = value;
+                    *(float *)request->value = hid_io_decode_axis(io, buffer);
                     break;
-                }
                 case HID_REQUEST_BUTTON:
-                    // set value to bit request->io_index of buffer
-                    *(bool *)request->value = (buffer[offset] >> io->report_offset) & 1;
+                    *(bool *)request->value = hid_io_decode_button(io, buffer);
                     break;
                 case HID_REQUEST_LIGHT:
+                {
                     // set bit io->report_offset of byte offset in buffer to request->value
+                    int offset = hid_io_offset(io);
                     buffer[offset] = buffer[offset] & (~(1 << io->report_offset)) | (*(int8_t *)request->value << request->io_index);
                     break;
+                }
             }
         }
 
@@ -542,4 +588,6 @@ void hid_device_update(HIDDevice *device)
     // request_groups isnt freed as the next gets/sets will overwrite previous values
     // this makes it so it doesnt have to be freed and mallocd every update
     device->num_request_groups = 0;
+
+    trace_end("hid_device_update");
 }
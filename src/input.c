@@ -0,0 +1,201 @@
+#include "input.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <poll.h>
+#include <sched.h>
+
+#include "timing.h"
+
+void write_event(Input *input, InputEvent event)
+{
+    unsigned int written = atomic_load_explicit(&input->events_written, memory_order_relaxed);
+    unsigned int num_read = atomic_load_explicit(&input->events_read, memory_order_acquire);
+
+    // drop the event if the ring is full, as the reader has fallen too far behind
+    if (written - num_read >= INPUT_MAX_EVENTS)
+    {
+        atomic_fetch_add_explicit(&input->events_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    // write the event, then publish it to the reader
+    input->events[written & (INPUT_MAX_EVENTS - 1)] = event;
+    atomic_store_explicit(&input->events_written, written + 1, memory_order_release);
+}
+
+bool input_read_event(Input *input, InputEvent *event)
+{
+    unsigned int num_read = atomic_load_explicit(&input->events_read, memory_order_relaxed);
+    unsigned int written = atomic_load_explicit(&input->events_written, memory_order_acquire);
+
+    // return if there are no unread events
+    if (num_read == written)
+        return false;
+
+    // read the event, then release its slot to the writer
+    *event = input->events[num_read & (INPUT_MAX_EVENTS - 1)];
+    atomic_store_explicit(&input->events_read, num_read + 1, memory_order_release);
+    return true;
+}
+
+void process_button(Input *input,
+                    const char *report,
+                    int index,
+                    bool *state,
+                    InputEventType type,
+                    int lane,
+                    int64_t time)
+{
+    // skip the button if it is not in the given report
+    if (input->device->buttons[index].report_id != (uint8_t)report[0])
+        return;
+
+    // write an event if the button changed states
+    bool pressed = hid_device_report_button(input->device, report, index);
+    if (pressed != *state)
+    {
+        *state = pressed;
+        write_event(input, (InputEvent)
+        {
+            .time = time,
+            .type = type,
+            .lane = lane,
+            .pressed = pressed,
+        });
+    }
+}
+
+void process_knob(Input *input, const char *report, int index, int lane, int64_t time)
+{
+    // skip the axis if it is not in the given report
+    if (input->device->axes[index].report_id != (uint8_t)report[0])
+        return;
+
+    // write an event if the knob turned
+    float value = hid_device_report_axis(input->device, report, index);
+    if (value != input->knob_values[lane])
+    {
+        input->knob_values[lane] = value;
+        write_event(input, (InputEvent)
+        {
+            .time = time,
+            .value = value,
+            .type = InputEventKnob,
+            .lane = lane,
+        });
+    }
+}
+
+void process_report(Input *input, const char *report, int64_t time)
+{
+    HIDConfig *config = &input->config;
+    uint8_t bt_indexes[CHART_BT_LANES] = { config->bt_a, config->bt_b, config->bt_c, config->bt_d };
+    uint8_t fx_indexes[CHART_FX_LANES] = { config->fx_l, config->fx_r };
+    uint8_t knob_indexes[CHART_ANALOG_LANES] = { config->vol_l, config->vol_r };
+
+    // write events for all the buttons and knobs that changed in the given report
+    for (int i = 0; i < CHART_BT_LANES; i++)
+        process_button(input, report, bt_indexes[i], &input->bt_states[i], InputEventBt, i, time);
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+        process_button(input, report, fx_indexes[i], &input->fx_states[i], InputEventFx, i, time);
+
+    process_button(input, report, config->start, &input->start_state, InputEventStart, 0, time);
+
+    for (int i = 0; i < CHART_ANALOG_LANES; i++)
+        process_knob(input, report, knob_indexes[i], i, time);
+}
+
+void *input_thread(void *data)
+{
+    Input *input = data;
+    struct pollfd fd = { .fd = input->device->fd, .events = POLLIN };
+
+    while (atomic_load(&input->running))
+    {
+        // wait for a report to arrive
+        // times out so the thread can check if it should stop
+        if (poll(&fd, 1, INPUT_POLL_TIMEOUT) <= 0)
+            continue;
+
+        // stop polling if the device was unplugged, as poll would return immediately from now on
+        if (fd.revents & (POLLERR | POLLHUP | POLLNVAL))
+            break;
+
+        // timestamp and process every unread report
+        char report[HID_MAX_BUFFER];
+        int result;
+        while ((result = hid_device_read_report(input->device, report, sizeof(report))) > 0)
+            process_report(input, report, time_nanoseconds());
+
+        // stop polling if reading failed
+        if (result < 0)
+            break;
+    }
+
+    // flag the device as disconnected if the thread stopped without being asked to
+    if (atomic_load(&input->running))
+    {
+        printf("input_thread: device disconnected\n");
+        atomic_store(&input->disconnected, true);
+    }
+
+    return NULL;
+}
+
+Input *input_create(HIDDevice *device, HIDConfig config)
+{
+    // create the input
+    Input *input = malloc(sizeof(Input));
+
+    // set the inputs properties
+    input->device = device;
+    input->config = config;
+    atomic_init(&input->running, true);
+    atomic_init(&input->disconnected, false);
+    atomic_init(&input->events_written, 0);
+    atomic_init(&input->events_read, 0);
+    atomic_init(&input->events_dropped, 0);
+
+    // default all the states
+    for (int i = 0; i < CHART_BT_LANES; i++)
+        input->bt_states[i] = false;
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+        input->fx_states[i] = false;
+
+    for (int i = 0; i < CHART_ANALOG_LANES; i++)
+        input->knob_values[i] = 0;
+
+    input->start_state = false;
+
+    // start the input thread
+    int result = pthread_create(&input->thread, NULL, input_thread, input);
+    assert(result == 0);
+
+    // try to run the input thread at a high priority so reports are timestamped as soon as they arrive
+    // this needs privileges, so input still works without it
+    struct sched_param param = { .sched_priority = sched_get_priority_max(SCHED_FIFO) };
+    if (pthread_setschedparam(input->thread, SCHED_FIFO, &param) != 0)
+        printf("input_create: unable to raise input thread priority\n");
+
+    // return the input
+    return input;
+}
+
+bool input_disconnected(Input *input)
+{
+    return atomic_load(&input->disconnected);
+}
+
+void input_free(Input *input)
+{
+    // stop and wait for the input thread
+    atomic_store(&input->running, false);
+    pthread_join(input->thread, NULL);
+
+    // free the input
+    free(input);
+}
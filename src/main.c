@@ -8,6 +8,7 @@
 #include "screen.h"
 #include "shader.h"
 #include "program.h"
+#include "timing.h"
 
 int main()
 {
@@ -142,8 +143,8 @@ int main()
 
     while (1)
     {
-        // store the time at the start of the frame to calculate the duration of the frame
-        clock_t start_time = clock();
+        // get the deadline for the end of this frame
+        int64_t frame_deadline = time_deadline(TIME_NANOSECONDS_PER_SECOND / SCREEN_RATE);
 
         // clear the colour buffer
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -173,13 +174,8 @@ int main()
         // update the screen
         screen_update(screen);
 
-        // calculte the length of the frame in milliseconds
-        frame_end = clock();
-        double frame_time = (((double) (frame_end - frame_start)) / CLOCKS_PER_SEC) * 1000.0;
-
         // sleep for the remainder of the frame if it finished before the framerate limit
-        if (frame_time < (1000.0 / SCREEN_RATE))
-            usleep((1000.0 / SCREEN_RATE) - frame_time);
+        time_sleep_until(frame_deadline);
     }
 
     // delete everything
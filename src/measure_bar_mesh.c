@@ -3,6 +3,7 @@
 #include <stdlib.h>
 
 #include "track.h"
+#include "gl_stats.h"
 
 void load_measure_bars(MeasureBarMesh *mesh)
 {
@@ -76,32 +77,48 @@ void measure_bar_mesh_free(MeasureBarMesh *mesh)
     free(mesh);
 }
 
+int find_measure_bar(MeasureBarMesh *mesh, int subbeat)
+{
+    // get the index of the first measure bar in the given mesh that is after the given subbeat
+    // measure bars are in order, so their subbeats are sorted
+    int low = 0;
+    int high = mesh->chart->num_measures;
+
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if (mesh->measure_bar_subbeats[middle] <= subbeat)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
 void measure_bar_mesh_draw(MeasureBarMesh *mesh,
-                           mat4_t projection,
-                           mat4_t view,
+                           mat4_t view_projection,
                            mat4_t model,
                            uint16_t start_subbeat,
                            uint16_t end_subbeat,
                            double speed)
 {
-    // normal blending for measure bars
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
     // draw the measure bars
     program_use(mesh->program);
-    program_set_matrices(mesh->program, projection, view, model);
+    program_set_mvp(mesh->program, m4_mul(view_projection, model));
     glUniform1f(mesh->uniform_speed_id, speed);
     mesh_draw_start(mesh->mesh);
 
-    for (int i = 0; i < mesh->chart->num_measures; i++)
+    // get the range of measure bars that are in range
+    int first_measure_bar = find_measure_bar(mesh, start_subbeat - 1);
+    int last_measure_bar = find_measure_bar(mesh, end_subbeat);
+
+    for (int i = first_measure_bar; i < last_measure_bar; i++)
     {
-        // draw the current bar if its in range and not removed
-        if (mesh->measure_bar_subbeats[i] >= start_subbeat &&
-            mesh->measure_bar_subbeats[i] <= end_subbeat)
-        {
-            glUniform1f(mesh->uniform_position_id, mesh->measure_bar_positions[i]);
-            mesh_draw_vertices(mesh->mesh, 0, MEASURE_BAR_MESH_MEASURE_BAR_SIZE);
-        }
+        // draw the current bar
+        glUniform1f(mesh->uniform_position_id, mesh->measure_bar_positions[i]);
+        mesh_draw_vertices(mesh->mesh, 0, MEASURE_BAR_MESH_MEASURE_BAR_SIZE);
     }
 
     mesh_draw_end(mesh->mesh);
@@ -1,12 +1,84 @@
 #include "mesh.h"
 
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
 
-Mesh *mesh_create(int max_vertices, Program *program, GLenum usage)
+#include "render_state.h"
+#include "gl_stats.h"
+
+// the index buffer shared by every compact mesh, and the number of compact meshes using it
+// every compact quad is indexed the same way, so one buffer covering a chunk of vertices is enough for every chunk
+static GLuint quad_index_buffer_id;
+static int quad_index_buffer_users;
+
+void retain_quad_index_buffer()
+{
+    // only create the buffer for the first user
+    if (quad_index_buffer_users++ > 0)
+        return;
+
+    // generate the indices of two triangles for each quad
+    // matching the vertex order of mesh_set_vertices_quad_edges, top left, top right, bottom right, bottom left
+    int num_quads = MESH_COMPACT_CHUNK_VERTICES / MESH_COMPACT_VERTICES_QUAD;
+    GLushort *indices = malloc(num_quads * MESH_COMPACT_INDICES_QUAD * sizeof(GLushort));
+
+    for (int i = 0; i < num_quads; i++)
+    {
+        GLushort vertex = i * MESH_COMPACT_VERTICES_QUAD;
+        GLushort *quad = &indices[i * MESH_COMPACT_INDICES_QUAD];
+
+        quad[0] = vertex;
+        quad[1] = vertex + 1;
+        quad[2] = vertex + 2;
+
+        quad[3] = vertex + 2;
+        quad[4] = vertex + 3;
+        quad[5] = vertex;
+    }
+
+    // create the buffer
+    glGenBuffers(1, &quad_index_buffer_id);
+    assert(quad_index_buffer_id != 0);
+
+    render_state_bind_index_buffer(quad_index_buffer_id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, num_quads * MESH_COMPACT_INDICES_QUAD * sizeof(GLushort), indices, GL_STATIC_DRAW);
+
+    free(indices);
+}
+
+void release_quad_index_buffer()
+{
+    // only delete the buffer once it has no users
+    if (--quad_index_buffer_users > 0)
+        return;
+
+    render_state_forget_buffer(quad_index_buffer_id);
+    glDeleteBuffers(1, &quad_index_buffer_id);
+}
+
+size_t vertex_size(Mesh *mesh)
+{
+    // get the size in bytes of a single vertex in the given mesh
+    switch (mesh->layout)
+    {
+        case MeshLayoutCompact:
+            return sizeof(MeshCompactVertex);
+        default:
+            return MESH_VERTEX_VALUES * sizeof(GLfloat);
+    }
+}
+
+Mesh *create_mesh(MeshLayout layout, int max_vertices, Program *program, GLenum usage)
 {
     // create the mesh
     Mesh *mesh = malloc(sizeof(Mesh));
+    mesh->layout = layout;
     mesh->max_vertices = max_vertices;
+    mesh->usage = usage;
+    mesh->staging_vertices = NULL;
+    mesh->has_extra_attribute = false;
     mesh->program = program;
 
     // get the vertex position attribute
@@ -17,8 +89,36 @@ Mesh *mesh_create(int max_vertices, Program *program, GLenum usage)
     assert(mesh->vertex_buffer_id != 0);
 
     // allocate the vertex buffer data
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer_id);
-    glBufferData(GL_ARRAY_BUFFER, mesh->max_vertices * MESH_VERTEX_VALUES * sizeof(float), NULL, usage);
+    render_state_bind_buffer(mesh->vertex_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, mesh->max_vertices * vertex_size(mesh), NULL, usage);
+
+    // return the mesh
+    return mesh;
+}
+
+Mesh *mesh_create(int max_vertices, Program *program, GLenum usage)
+{
+    return create_mesh(MeshLayoutFloat, max_vertices, program, usage);
+}
+
+Mesh *mesh_create_compact(int max_vertices, Program *program, GLenum usage)
+{
+    // assert that the vertices are whole quads, so no quad is split between chunks
+    assert(max_vertices % MESH_COMPACT_VERTICES_QUAD == 0);
+
+    // create the mesh
+    Mesh *mesh = create_mesh(MeshLayoutCompact, max_vertices, program, usage);
+
+    // get the track position attribute
+    mesh->attribute_vertex_track_position_id = program_get_attribute_id(program, "vertexTrackPosition");
+
+    // set the range the normalized positions are scaled by
+    // uniforms keep their values, so this only needs setting once
+    program_use(program);
+    glUniform1f(program_get_uniform_id(program, "positionRange"), MESH_COMPACT_POSITION_RANGE);
+
+    // use the shared index buffer
+    retain_quad_index_buffer();
 
     // return the mesh
     return mesh;
@@ -26,15 +126,75 @@ Mesh *mesh_create(int max_vertices, Program *program, GLenum usage)
 
 void mesh_free(Mesh *mesh)
 {
+    free(mesh->staging_vertices);
+
+    if (mesh->layout == MeshLayoutCompact)
+        release_quad_index_buffer();
+
+    render_state_forget_buffer(mesh->vertex_buffer_id);
     glDeleteBuffers(1, &mesh->vertex_buffer_id);
     free(mesh);
 }
 
-void mesh_set_vertices(Mesh *mesh, int index, const GLfloat *vertices, size_t vertices_size)
+void mesh_set_extra_attribute(Mesh *mesh, GLuint attribute_id, GLuint buffer_id, GLint size)
+{
+    mesh->has_extra_attribute = true;
+    mesh->attribute_extra_id = attribute_id;
+    mesh->extra_buffer_id = buffer_id;
+    mesh->extra_size = size;
+}
+
+void set_extra_attribute(Mesh *mesh, int first_vertex)
+{
+    if (!mesh->has_extra_attribute)
+        return;
+
+    // point the extra attribute at the values of the given vertex onwards
+    render_state_set_attribute_format(mesh->attribute_extra_id, (RenderStateAttribute)
+    {
+        .buffer_id = mesh->extra_buffer_id,
+        .size = mesh->extra_size,
+        .type = GL_FLOAT,
+        .normalized = GL_FALSE,
+        .stride = 0,
+        .offset = first_vertex * mesh->extra_size * sizeof(GLfloat),
+    });
+}
+
+void mesh_stage_vertices(Mesh *mesh)
+{
+    // assert that the mesh is not already staging
+    assert(mesh->staging_vertices == NULL);
+
+    mesh->staging_vertices = calloc(mesh->max_vertices, vertex_size(mesh));
+}
+
+void mesh_upload_vertices(Mesh *mesh)
+{
+    // assert that the mesh is staging
+    assert(mesh->staging_vertices != NULL);
+
+    // replace the vertex buffer data with the staged vertices
+    render_state_bind_buffer(mesh->vertex_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, mesh->max_vertices * vertex_size(mesh), mesh->staging_vertices, mesh->usage);
+
+    free(mesh->staging_vertices);
+    mesh->staging_vertices = NULL;
+}
+
+void mesh_set_vertices(Mesh *mesh, int index, const void *vertices, size_t vertices_size)
 {
+    // write the vertices to the staging copy if the mesh is staging
+    if (mesh->staging_vertices != NULL)
+    {
+        assert(index * vertex_size(mesh) + vertices_size <= mesh->max_vertices * vertex_size(mesh));
+        memcpy((char *)mesh->staging_vertices + index * vertex_size(mesh), vertices, vertices_size);
+        return;
+    }
+
     // bind the vertex buffer and set its vertices starting at offset
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer_id);
-    glBufferSubData(GL_ARRAY_BUFFER, index * MESH_VERTEX_VALUES * sizeof(float), vertices_size, vertices);
+    render_state_bind_buffer(mesh->vertex_buffer_id);
+    glBufferSubData(GL_ARRAY_BUFFER, index * vertex_size(mesh), vertices_size, vertices);
 }
 
 void mesh_set_vertices_quad(Mesh *mesh, int index, GLfloat width, GLfloat height, vec3_t position)
@@ -81,18 +241,84 @@ void mesh_set_vertices_quad_edges(Mesh *mesh, int index, GLfloat width, vec3_t s
     mesh_set_vertices(mesh, index, vertices, sizeof(vertices));
 }
 
+GLshort compact_position(GLfloat position)
+{
+    // clamp the position to the range
+    position = fmaxf(-MESH_COMPACT_POSITION_RANGE, fminf(MESH_COMPACT_POSITION_RANGE, position));
+
+    // normalize the position to the range of a short
+    return roundf(position / MESH_COMPACT_POSITION_RANGE * 32767.0f);
+}
+
+void mesh_set_compact_quad_edges(Mesh *mesh, int index, GLfloat width, vec3_t start_position, vec3_t end_position)
+{
+    // assert that the mesh is compact
+    assert(mesh->layout == MeshLayoutCompact);
+
+    // calculate the x positions, mirrored the same as mesh_set_vertices_quad_edges
+    GLfloat start_x = -start_position.x;
+    GLfloat end_x = -end_position.x;
+
+    // generate the quad
+    const MeshCompactVertex vertices[MESH_COMPACT_VERTICES_QUAD] =
+    {
+        { compact_position(end_x),           compact_position(end_position.y),   end_position.z },   //top left
+        { compact_position(end_x - width),   compact_position(end_position.y),   end_position.z },   //top right
+        { compact_position(start_x - width), compact_position(start_position.y), start_position.z }, //bottom right
+        { compact_position(start_x),         compact_position(start_position.y), start_position.z }, //bottom left
+    };
+
+    // set the mesh vertices
+    mesh_set_vertices(mesh, index, vertices, sizeof(vertices));
+}
+
+void set_compact_attributes(Mesh *mesh, int first_vertex)
+{
+    // point the vertex attributes of the given compact mesh at its vertices from the given vertex
+    GLsizeiptr offset = first_vertex * sizeof(MeshCompactVertex);
+
+    render_state_set_attribute_format(mesh->attribute_vertex_position_id, (RenderStateAttribute)
+    {
+        .buffer_id = mesh->vertex_buffer_id,
+        .size = 2,
+        .type = GL_SHORT,
+        .normalized = GL_TRUE,
+        .stride = sizeof(MeshCompactVertex),
+        .offset = offset + offsetof(MeshCompactVertex, x),
+    });
+
+    render_state_set_attribute_format(mesh->attribute_vertex_track_position_id, (RenderStateAttribute)
+    {
+        .buffer_id = mesh->vertex_buffer_id,
+        .size = 1,
+        .type = GL_FLOAT,
+        .normalized = GL_FALSE,
+        .stride = sizeof(MeshCompactVertex),
+        .offset = offset + offsetof(MeshCompactVertex, track_position),
+    });
+
+    set_extra_attribute(mesh, first_vertex);
+}
+
 void mesh_draw_start(Mesh *mesh)
 {
     // pass the vertex buffer vertices to the meshes program
-    glEnableVertexAttribArray(mesh->attribute_vertex_position_id);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer_id);
-    glVertexAttribPointer(mesh->attribute_vertex_position_id, MESH_VERTEX_VALUES, GL_FLOAT, GL_FALSE, 0, NULL);
+    if (mesh->layout == MeshLayoutCompact)
+    {
+        set_compact_attributes(mesh, 0);
+        render_state_bind_index_buffer(quad_index_buffer_id);
+    }
+    else
+    {
+        render_state_set_attribute(mesh->attribute_vertex_position_id, mesh->vertex_buffer_id, MESH_VERTEX_VALUES);
+        set_extra_attribute(mesh, 0);
+    }
 }
 
 void mesh_draw_end(Mesh *mesh)
 {
-    // disable the vertex attribute array
-    glDisableVertexAttribArray(mesh->attribute_vertex_position_id);
+    // the vertex attribute is left enabled so the next draw using it can skip enabling it again
+    // program_use disables it if the next program does not use it
 }
 
 void mesh_draw_vertices(Mesh *mesh, int index, size_t size)
@@ -102,7 +328,33 @@ void mesh_draw_vertices(Mesh *mesh, int index, size_t size)
     assert(index + size <= mesh->max_vertices);
 
     // draw the vertices
-    glDrawArrays(GL_TRIANGLES, index, size);
+    // compact meshes draw their quads through the shared index buffer
+    if (mesh->layout == MeshLayoutCompact)
+    {
+        assert(index % MESH_COMPACT_VERTICES_QUAD == 0 && size % MESH_COMPACT_VERTICES_QUAD == 0);
+
+        // draw each chunk the vertices are in separately, as the indices can only reach one chunk
+        int end = index + size;
+        while (index < end)
+        {
+            int chunk_start = index / MESH_COMPACT_CHUNK_VERTICES * MESH_COMPACT_CHUNK_VERTICES;
+            int chunk_end = chunk_start + MESH_COMPACT_CHUNK_VERTICES;
+            int draw_end = (end < chunk_end) ? end : chunk_end;
+
+            // point the attributes at the start of the chunk, so its vertices are indexed from 0
+            set_compact_attributes(mesh, chunk_start);
+
+            size_t first_index = (index - chunk_start) / MESH_COMPACT_VERTICES_QUAD * MESH_COMPACT_INDICES_QUAD;
+            glDrawElements(GL_TRIANGLES,
+                           (draw_end - index) / MESH_COMPACT_VERTICES_QUAD * MESH_COMPACT_INDICES_QUAD,
+                           GL_UNSIGNED_SHORT,
+                           (const GLvoid *)(first_index * sizeof(GLushort)));
+
+            index = draw_end;
+        }
+    }
+    else
+        glDrawArrays(GL_TRIANGLES, index, size);
 }
 
 void mesh_draw_all(Mesh *mesh)
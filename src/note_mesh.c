@@ -6,55 +6,175 @@
 
 #include "track.h"
 #include "shared.h"
+#include "render_state.h"
+#include "gl_stats.h"
+#include "profile.h"
 
-void load_notes(NoteMesh *mesh)
+typedef struct
 {
-    // the index of the current hold vertices
-    int hold_vertices_index = 0;
+    // the lane and index of a note
+    int lane, index;
 
-    for (int l = 0; l < mesh->num_lanes; l++)
-    {
-        // the x position of notes in this lane
-        float lane_position = (l * mesh->note_width) - (TRACK_NOTES_WIDTH / 2);
+    // the start subbeat of the note
+    uint16_t subbeat;
+} NoteOrder;
+
+int compare_note_orders(const void *a, const void *b)
+{
+    const NoteOrder *order_a = a;
+    const NoteOrder *order_b = b;
+
+    // sort by start subbeat, then by lane so the order is always the same
+    if (order_a->subbeat != order_b->subbeat)
+        return order_a->subbeat - order_b->subbeat;
+
+    return order_a->lane - order_b->lane;
+}
 
-        // create the chip vertices for this lane
-        mesh_set_vertices_quad(mesh->chips_mesh,
-                               l * NOTE_MESH_CHIP_SIZE,
-                               mesh->note_width,
-                               NOTE_MESH_CHIP_HEIGHT,
-                               vec3(lane_position, 0, 0));
+NoteOrder *sort_notes(NoteMesh *mesh, bool holds, int num_orders, int **indexes)
+{
+    // get the order of every chip, or every hold if holds, in the given mesh
+    NoteOrder *orders = malloc(num_orders * sizeof(NoteOrder));
+    int order_index = 0;
 
+    for (int l = 0; l < mesh->num_lanes; l++)
+    {
         for (int n = 0; n < mesh->num_notes[l]; n++)
         {
             Note *note = &mesh->notes[l][n];
 
-            // get the position of the current note
-            vec3_t position = vec3(lane_position,
-                                   track_subbeat_position(note->start_subbeat),
-                                   0);
-
-            // set position and continue if the current note is a chip, as thats all chips need
-            if (!note->hold)
+            // notes of the other type have no index
+            if (note->hold != holds)
             {
-                mesh->chip_positions[l][n] = position.y;
+                indexes[l][n] = INDEX_NONE;
                 continue;
             }
 
-            // get the size of the current hold
-            vec3_t size = vec3(mesh->note_width,
-                               track_subbeat_position(note->end_subbeat) - position.y,
-                               0);
+            orders[order_index++] = (NoteOrder)
+            {
+                .lane = l,
+                .index = n,
+                .subbeat = note->start_subbeat,
+            };
+        }
+    }
+
+    // sort the notes by subbeat
+    qsort(orders, num_orders, sizeof(NoteOrder), compare_note_orders);
 
-            // add the hold vertices to the holds mesh
-            mesh_set_vertices_quad(mesh->holds_mesh,
-                                   hold_vertices_index,
-                                   size.x, size.y,
-                                   position);
+    // set the index of each note in the sorted order
+    for (int i = 0; i < num_orders; i++)
+        indexes[orders[i].lane][orders[i].index] = i;
 
-            // increment the hold vertices index
-            hold_vertices_index += NOTE_MESH_HOLD_SIZE;
-        }
+    return orders;
+}
+
+void load_chips(NoteMesh *mesh)
+{
+    NoteOrder *orders = sort_notes(mesh, false, mesh->num_chips, mesh->chip_indexes);
+
+    // build the chips mesh on the cpu and upload it once
+    mesh_stage_vertices(mesh->chips_mesh);
+
+    for (int i = 0; i < mesh->num_chips; i++)
+    {
+        NoteOrder *order = &orders[i];
+
+        // the x position of notes in this chips lane
+        float lane_position = (order->lane * mesh->note_width) - (TRACK_NOTES_WIDTH / 2);
+
+        // add the chip vertices to the chips mesh
+        // the draw position at 1x speed of the chip is its track position, and chip.vs scales it by speed
+        float position = track_subbeat_position(order->subbeat);
+        mesh_set_compact_quad_edges(mesh->chips_mesh,
+                                    i * NOTE_MESH_CHIP_SIZE,
+                                    mesh->note_width,
+                                    vec3(lane_position, 0, position),
+                                    vec3(lane_position, NOTE_MESH_CHIP_HEIGHT, position));
+
+        mesh->chip_subbeats[i] = order->subbeat;
+    }
+
+    mesh_upload_vertices(mesh->chips_mesh);
+    free(orders);
+}
+
+void load_holds(NoteMesh *mesh)
+{
+    NoteOrder *orders = sort_notes(mesh, true, mesh->num_holds, mesh->hold_indexes);
+
+    // the latest end subbeat of the holds so far
+    uint16_t max_end_subbeat = 0;
+
+    // build the holds mesh on the cpu and upload it once
+    mesh_stage_vertices(mesh->holds_mesh);
+
+    for (int i = 0; i < mesh->num_holds; i++)
+    {
+        NoteOrder *order = &orders[i];
+        Note *note = &mesh->notes[order->lane][order->index];
+
+        // get the start and end positions of the current hold along the track
+        float lane_position = (order->lane * mesh->note_width) - (TRACK_NOTES_WIDTH / 2);
+        vec3_t start_position = vec3(lane_position, 0, track_subbeat_position(note->start_subbeat));
+        vec3_t end_position = vec3(lane_position, 0, track_subbeat_position(note->end_subbeat));
+
+        // add the hold vertices to the holds mesh
+        mesh_set_compact_quad_edges(mesh->holds_mesh,
+                                    i * NOTE_MESH_HOLD_SIZE,
+                                    mesh->note_width,
+                                    start_position,
+                                    end_position);
+
+        // store the holds subbeats
+        if (note->end_subbeat > max_end_subbeat)
+            max_end_subbeat = note->end_subbeat;
+
+        mesh->hold_start_subbeats[i] = note->start_subbeat;
+        mesh->hold_max_end_subbeats[i] = max_end_subbeat;
+    }
+
+    mesh_upload_vertices(mesh->holds_mesh);
+
+    // default the state of every hold
+    GLfloat *states = malloc(mesh->num_holds * NOTE_MESH_HOLD_SIZE * sizeof(GLfloat));
+    for (int i = 0; i < mesh->num_holds * NOTE_MESH_HOLD_SIZE; i++)
+        states[i] = HoldStateDefault;
+
+    render_state_bind_buffer(mesh->hold_states_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, mesh->num_holds * NOTE_MESH_HOLD_SIZE * sizeof(GLfloat), states, GL_DYNAMIC_DRAW);
+
+    free(states);
+    free(orders);
+}
+
+void set_hold_state(NoteMesh *mesh, int lane, int index, HoldState state)
+{
+    // set the state of each vertex of the hold at the given lane and index
+    GLfloat states[NOTE_MESH_HOLD_SIZE];
+    for (int i = 0; i < NOTE_MESH_HOLD_SIZE; i++)
+        states[i] = state;
+
+    int hold = mesh->hold_indexes[lane][index];
+    render_state_bind_buffer(mesh->hold_states_buffer_id);
+    glBufferSubData(GL_ARRAY_BUFFER, hold * NOTE_MESH_HOLD_SIZE * sizeof(GLfloat), sizeof(states), states);
+}
+
+int find_subbeat(const uint16_t *subbeats, int low, int high, int subbeat)
+{
+    // get the index of the first of the given sorted subbeats between low and high that is after the given subbeat
+    // returns high if there are none
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if (subbeats[middle] <= subbeat)
+            low = middle + 1;
+        else
+            high = middle;
     }
+
+    return low;
 }
 
 NoteMesh *note_mesh_create(const char *type_name,
@@ -63,6 +183,10 @@ NoteMesh *note_mesh_create(const char *type_name,
                            Note *notes[num_lanes],
                            float note_width)
 {
+    char profile_name[PROFILE_NAME_SIZE];
+    snprintf(profile_name, sizeof(profile_name), "note_mesh_create %s", type_name);
+    int profile_phase = profile_begin(profile_name);
+
     // create the note mesh
     NoteMesh *mesh = malloc(sizeof(NoteMesh));
 
@@ -71,15 +195,15 @@ NoteMesh *note_mesh_create(const char *type_name,
     mesh->num_notes = num_notes;
     mesh->notes = notes;
     mesh->note_width = note_width;
-    mesh->chip_positions = malloc(num_lanes * sizeof(float *));
-    mesh->chips_removed = calloc(num_lanes, sizeof(bool *));
+    mesh->chip_indexes = malloc(num_lanes * sizeof(int *));
+    mesh->hold_indexes = malloc(num_lanes * sizeof(int *));
     mesh->current_hold_indexes = malloc(num_lanes * sizeof(int));
     mesh->current_hold_states = malloc(num_lanes * sizeof(HoldState));
 
     for (int i = 0; i < num_lanes; i++)
     {
-        mesh->chip_positions[i] = malloc(num_notes[i] * sizeof(float));
-        mesh->chips_removed[i] = calloc(num_notes[i], sizeof(bool));
+        mesh->chip_indexes[i] = malloc(num_notes[i] * sizeof(int));
+        mesh->hold_indexes[i] = malloc(num_notes[i] * sizeof(int));
         mesh->current_hold_indexes[i] = INDEX_NONE;
         mesh->current_hold_states[i] = HoldStateDefault;
     }
@@ -91,7 +215,6 @@ NoteMesh *note_mesh_create(const char *type_name,
 
     mesh->chips_program = program_create("chip.vs", chip_fragment_path, true);
     mesh->uniform_chips_speed_id = program_get_uniform_id(mesh->chips_program, "speed");
-    mesh->uniform_chips_position_id = program_get_uniform_id(mesh->chips_program, "position");
 
     // create the hold program
     char hold_fragment_path[PATH_MAX];
@@ -100,21 +223,41 @@ NoteMesh *note_mesh_create(const char *type_name,
 
     mesh->holds_program = program_create("hold.vs", hold_fragment_path, true);
     mesh->uniform_holds_speed_id = program_get_uniform_id(mesh->holds_program, "speed");
-    mesh->uniform_holds_state_id = program_get_uniform_id(mesh->holds_program, "state");
+    mesh->attribute_holds_state_id = program_get_attribute_id(mesh->holds_program, "vertexState");
 
-    // create the chip and hold meshes
-    mesh->chips_mesh = mesh_create(num_lanes * NOTE_MESH_CHIP_SIZE, mesh->chips_program, GL_STATIC_DRAW);
+    // count the chips and holds
+    mesh->num_chips = 0;
+    mesh->num_holds = 0;
 
-    int num_holds = 0;
     for (int l = 0; l < num_lanes; l++)
+    {
         for (int n = 0; n < num_notes[l]; n++)
+        {
             if (notes[l][n].hold)
-                num_holds++;
+                mesh->num_holds++;
+            else
+                mesh->num_chips++;
+        }
+    }
+
+    mesh->chip_subbeats = malloc(mesh->num_chips * sizeof(uint16_t));
+    mesh->hold_start_subbeats = malloc(mesh->num_holds * sizeof(uint16_t));
+    mesh->hold_max_end_subbeats = malloc(mesh->num_holds * sizeof(uint16_t));
+
+    // create the chip and hold meshes
+    mesh->chips_mesh = mesh_create_compact(mesh->num_chips * NOTE_MESH_CHIP_SIZE, mesh->chips_program, GL_STATIC_DRAW);
+    mesh->holds_mesh = mesh_create_compact(mesh->num_holds * NOTE_MESH_HOLD_SIZE, mesh->holds_program, GL_STATIC_DRAW);
+
+    // create the hold states buffer, and pass it to the holds mesh with each holds vertices
+    glGenBuffers(1, &mesh->hold_states_buffer_id);
+    assert(mesh->hold_states_buffer_id != 0);
+    mesh_set_extra_attribute(mesh->holds_mesh, mesh->attribute_holds_state_id, mesh->hold_states_buffer_id, 1);
 
-    mesh->holds_mesh = mesh_create(num_holds * NOTE_MESH_HOLD_SIZE, mesh->holds_program, GL_STATIC_DRAW);
+    // load the chips and holds
+    load_chips(mesh);
+    load_holds(mesh);
 
-    // load the notes
-    load_notes(mesh);
+    profile_end(profile_phase);
 
     // return the note mesh
     return mesh;
@@ -128,16 +271,21 @@ void note_mesh_free(NoteMesh *mesh)
 
     for (int i = 0; i < mesh->num_lanes; i++)
     {
-        free(mesh->chip_positions[i]);
-        free(mesh->chips_removed[i]);
+        free(mesh->chip_indexes[i]);
+        free(mesh->hold_indexes[i]);
     }
 
-    free(mesh->chip_positions);
-    free(mesh->chips_removed);
+    free(mesh->chip_indexes);
+    free(mesh->chip_subbeats);
+    free(mesh->hold_indexes);
+    free(mesh->hold_start_subbeats);
+    free(mesh->hold_max_end_subbeats);
 
     // free the meshes
     mesh_free(mesh->chips_mesh);
     mesh_free(mesh->holds_mesh);
+    render_state_forget_buffer(mesh->hold_states_buffer_id);
+    glDeleteBuffers(1, &mesh->hold_states_buffer_id);
 
     // free the programs
     program_free(mesh->chips_program);
@@ -158,8 +306,9 @@ void note_mesh_remove_chip(NoteMesh *mesh, int lane, int index)
     // assert that the note is a chip
     assert(!mesh->notes[lane][index].hold);
 
-    // mark the chip as removed
-    mesh->chips_removed[lane][index] = true;
+    // collapse the chips vertices to a single point so it no longer draws
+    const MeshCompactVertex vertices[NOTE_MESH_CHIP_SIZE] = { 0 };
+    mesh_set_vertices(mesh->chips_mesh, mesh->chip_indexes[lane][index] * NOTE_MESH_CHIP_SIZE, vertices, sizeof(vertices));
 }
 
 void note_mesh_set_current_hold(NoteMesh *mesh, int lane, int index)
@@ -177,6 +326,18 @@ void note_mesh_set_current_hold(NoteMesh *mesh, int lane, int index)
         assert(mesh->notes[lane][index].hold);
     }
 
+    // return if the current hold is unchanged
+    int last_index = mesh->current_hold_indexes[lane];
+    if (index == last_index)
+        return;
+
+    // reset the state of the last current hold, and apply the current state to the new one
+    if (last_index != INDEX_NONE)
+        set_hold_state(mesh, lane, last_index, HoldStateDefault);
+
+    if (index != INDEX_NONE)
+        set_hold_state(mesh, lane, index, mesh->current_hold_states[lane]);
+
     // set the given meshes current hold for the given lane
     mesh->current_hold_indexes[lane] = index;
 }
@@ -186,99 +347,66 @@ void note_mesh_set_current_hold_state(NoteMesh *mesh, int lane, HoldState state)
     // assert that the lane is valid
     assert(lane >= 0 && lane < mesh->num_lanes);
 
+    // return if the state is unchanged
+    if (state == mesh->current_hold_states[lane])
+        return;
+
     // set the given lanes current hold state
     mesh->current_hold_states[lane] = state;
+
+    // apply the state to the current hold of the given lane, if any
+    if (mesh->current_hold_indexes[lane] != INDEX_NONE)
+        set_hold_state(mesh, lane, mesh->current_hold_indexes[lane], state);
 }
 
 void note_mesh_draw_chips(NoteMesh *mesh,
-                          mat4_t projection,
-                          mat4_t view,
+                          mat4_t view_projection,
                           mat4_t model,
                           uint16_t start_subbeat,
                           uint16_t end_subbeat,
                           double speed)
 {
-    // normal blending for chips
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
     // draw the chips
     program_use(mesh->chips_program);
-    program_set_matrices(mesh->chips_program, projection, view, model);
+    program_set_mvp(mesh->chips_program, m4_mul(view_projection, model));
     glUniform1f(mesh->uniform_chips_speed_id, speed);
-    mesh_draw_start(mesh->chips_mesh);
 
-    for (int l = 0; l < mesh->num_lanes; l++)
-    {
-        for (int n = 0; n < mesh->num_notes[l]; n++)
-        {
-            Note *note = &mesh->notes[l][n];
+    // draw all the chips in range in one draw, as they are sorted by subbeat
+    int first_chip = find_subbeat(mesh->chip_subbeats, 0, mesh->num_chips, start_subbeat - 1);
+    int last_chip = find_subbeat(mesh->chip_subbeats, first_chip, mesh->num_chips, end_subbeat);
 
-            // skip holds
-            if (note->hold)
-                continue;
-
-            // draw the current chip if its in range and not removed
-            if (note->start_subbeat >= start_subbeat && //after start_subbeat
-                note->start_subbeat <= end_subbeat && //before end_subbeat
-                !mesh->chips_removed[l][n]) //not removed
-            {
-                glUniform1f(mesh->uniform_chips_position_id, mesh->chip_positions[l][n]);
-                mesh_draw_vertices(mesh->chips_mesh, l * NOTE_MESH_CHIP_SIZE, NOTE_MESH_CHIP_SIZE);
-            }
-        }
+    if (first_chip < last_chip)
+    {
+        mesh_draw_start(mesh->chips_mesh);
+        mesh_draw_vertices(mesh->chips_mesh, first_chip * NOTE_MESH_CHIP_SIZE, (last_chip - first_chip) * NOTE_MESH_CHIP_SIZE);
+        mesh_draw_end(mesh->chips_mesh);
     }
-
-    mesh_draw_end(mesh->chips_mesh);
 }
 
 void note_mesh_draw_holds(NoteMesh *mesh,
-                          mat4_t projection,
-                          mat4_t view,
+                          mat4_t view_projection,
                           mat4_t model,
                           uint16_t start_subbeat,
                           uint16_t end_subbeat,
                           double speed)
 {
-    // additive blending for holds
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-
     // draw the holds
     program_use(mesh->holds_program);
-    program_set_matrices(mesh->holds_program, projection, view, model);
+    program_set_mvp(mesh->holds_program, m4_mul(view_projection, model));
     glUniform1f(mesh->uniform_holds_speed_id, speed);
-    mesh_draw_start(mesh->holds_mesh);
 
-    int vertices_index = 0;
-    for (int l = 0; l < mesh->num_lanes; l++)
-    {
-        for (int n = 0; n < mesh->num_notes[l]; n++)
-        {
-            Note *note = &mesh->notes[l][n];
-
-            // skip chips
-            if (!note->hold)
-                continue;
-
-            // apply the current hold state if the current hold is the current hold for the current lane
-            if (mesh->current_hold_indexes[l] == n)
-            {
-                HoldState state = mesh->current_hold_states[l];
-                glUniform1i(mesh->uniform_holds_state_id, state);
-            }
+    // get the range of holds that are in range
+    // holds are sorted by start subbeat, and the latest end subbeat of all the holds up to each hold is kept
+    // so every hold that ends at or after start_subbeat is after the first whose max end is at or after start_subbeat
+    int first_hold = find_subbeat(mesh->hold_max_end_subbeats, 0, mesh->num_holds, start_subbeat - 1);
+    int last_hold = find_subbeat(mesh->hold_start_subbeats, first_hold, mesh->num_holds, end_subbeat);
 
-            // draw the hold if its in range
-            if (note->end_subbeat >= start_subbeat && //after start_subbeat
-                note->start_subbeat <= end_subbeat) //before end_subbeat
-                mesh_draw_vertices(mesh->holds_mesh, vertices_index, NOTE_MESH_HOLD_SIZE);
-
-            // reset the hold programs state to default if it was changed
-            if (mesh->current_hold_indexes[l] == n)
-                glUniform1i(mesh->uniform_holds_state_id, HoldStateDefault);
-
-            // increment the vertices index
-            vertices_index += NOTE_MESH_HOLD_SIZE;
-        }
-    }
+    // return if there are no holds in range
+    if (first_hold >= last_hold)
+        return;
 
+    // draw all the holds in range in one draw, with each holds state from the hold states buffer
+    mesh_draw_start(mesh->holds_mesh);
+    mesh_draw_vertices(mesh->holds_mesh, first_hold * NOTE_MESH_HOLD_SIZE, (last_hold - first_hold) * NOTE_MESH_HOLD_SIZE);
     mesh_draw_end(mesh->holds_mesh);
 }
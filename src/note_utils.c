@@ -15,22 +15,74 @@ uint16_t note_time_at_beat_to_subbeat(Beat *note_beat, uint16_t measure, uint8_t
 
 uint16_t note_time_to_subbeat(Chart *chart, uint16_t measure, uint8_t beat, uint8_t subbeat)
 {
-    // get the index of the beat for the given note timing
+    // get the index of the last beat that starts at or before the given measure
     int beat_index = 0;
+    int low = 0;
+    int high = chart->num_beats - 1;
 
-    for (int i = 0; i < chart->num_beats; i++)
+    while (low <= high)
     {
-        // break if the current beat is after the given note time
-        if (chart->beats[i].measure > measure)
-            break;
-
-        beat_index = i;
+        int middle = low + (high - low) / 2;
+
+        if (chart->beats[middle].measure <= measure)
+        {
+            beat_index = middle;
+            low = middle + 1;
+        }
+        else
+            high = middle - 1;
     }
 
     // return the subbeat
     return note_time_at_beat_to_subbeat(&chart->beats[beat_index], measure, beat, subbeat);
 }
 
+int tempo_index_at_subbeat(Chart *chart, double subbeat)
+{
+    // get the index of the last tempo that starts at or before the given subbeat
+    int tempo_index = 0;
+    int low = 0;
+    int high = chart->num_tempos - 1;
+
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if (chart->tempos[middle].subbeat <= subbeat)
+        {
+            tempo_index = middle;
+            low = middle + 1;
+        }
+        else
+            high = middle - 1;
+    }
+
+    return tempo_index;
+}
+
+int tempo_index_at_time(Chart *chart, double time)
+{
+    // get the index of the last tempo that starts at or before the given time
+    int tempo_index = 0;
+    int low = 0;
+    int high = chart->num_tempos - 1;
+
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if (chart->tempos[middle].time <= time)
+        {
+            tempo_index = middle;
+            low = middle + 1;
+        }
+        else
+            high = middle - 1;
+    }
+
+    return tempo_index;
+}
+
 double subbeats_at_tempo_to_duration(Tempo *tempo, uint16_t subbeats)
 {
     // calculate and return the duration in milliseconds of the given number of subbeats at the given tempo
@@ -49,6 +101,12 @@ double subbeat_at_tempo_to_time(Tempo *tempo, uint16_t subbeat)
     return tempo->time + relative_time;
 }
 
+double subbeat_to_time(Chart *chart, uint16_t subbeat)
+{
+    // get the time of the given subbeat relative to the tempo it is in
+    return subbeat_at_tempo_to_time(&chart->tempos[tempo_index_at_subbeat(chart, subbeat)], subbeat);
+}
+
 double time_to_subbeat(Chart *chart, int tempo_index, double time)
 {
     // assert that tempo_index is valid
@@ -4,20 +4,26 @@
 #include <libgen.h>
 #include <string.h>
 
+// the directory containing the executable
+// it never changes while running, so it is only read once
+static char executable_dirname[PATH_MAX];
+
 void path_get_relative(const char *path, char output_path[PATH_MAX])
 {
-    // get the executable path
-    char executable_path[PATH_MAX] = { 0 };
-    readlink("/proc/self/exe", executable_path, PATH_MAX);
+    // get the executable dirname, if it has not been read yet
+    if (executable_dirname[0] == '\0')
+    {
+        char executable_path[PATH_MAX] = { 0 };
+        readlink("/proc/self/exe", executable_path, PATH_MAX - 1);
+        strcpy(executable_dirname, dirname(executable_path));
+    }
 
-    // get the executable dirname
-    char *executable_dirname = dirname(executable_path);
+    // join executable_dirname and path in output_path
+    strcpy(output_path, executable_dirname);
 
-    // ensure executable_dirname will have a "/" dividing it and path
+    // ensure there is a "/" dividing executable_dirname and path
     if (strncmp("/", path, 1) != 0)
-        strcat(executable_dirname, "/");
+        strcat(output_path, "/");
 
-    // join executable_dirname and path in output_path
-    strcpy(output_path, executable_dirname);
     strcat(output_path, path);
 }
@@ -1,6 +1,9 @@
 #include "playback.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
 
 #include "scoring.h"
@@ -8,6 +11,24 @@
 #include "screen.h"
 #include "note_utils.h"
 #include "shared.h"
+#include "trace.h"
+
+void reset_cursors(Playback *playback)
+{
+    // move all the note cursors back to the first note of their lane
+    for (int i = 0; i < CHART_BT_LANES; i++)
+        playback->bt_note_cursors[i] = 0;
+
+    for (int i = 0; i < CHART_FX_LANES; i++)
+        playback->fx_note_cursors[i] = 0;
+
+    // move all the analog cursors back to the first segment of their lane
+    for (int i = 0; i < CHART_ANALOG_LANES; i++)
+    {
+        playback->analog_cursors[i] = 0;
+        playback->analog_point_cursors[i] = 0;
+    }
+}
 
 Playback *playback_create(Chart *chart, AudioTrack *audio_track, Track *track, Scoring *scoring)
 {
@@ -19,8 +40,22 @@ Playback *playback_create(Chart *chart, AudioTrack *audio_track, Track *track, S
     playback->audio_track = audio_track;
     playback->track = track;
     playback->scoring = scoring;
+    playback->input = NULL;
+    playback->frame_stats = NULL;
+    playback->recording = NULL;
+    playback->replay = NULL;
+    playback->replay_index = 0;
+    playback->timeline = timeline_create(chart);
+    playback->timeline_index = 0;
     playback->started = false;
+    playback->finished = false;
+    playback->clock_held = false;
+    playback->offset = chart->offset;
     playback->tempo_index = 0;
+    playback->last_update_time = 0;
+
+    // reset the note and analog cursors
+    reset_cursors(playback);
 
     // default all the current notes/analogs to none
     for (int i = 0; i < CHART_BT_LANES; i++)
@@ -41,9 +76,36 @@ Playback *playback_create(Chart *chart, AudioTrack *audio_track, Track *track, S
 
 void playback_free(Playback *playback)
 {
+    timeline_free(playback->timeline);
     free(playback);
 }
 
+void playback_set_input(Playback *playback, Input *input)
+{
+    playback->input = input;
+}
+
+void playback_set_recording(Playback *playback, Replay *recording)
+{
+    playback->recording = recording;
+}
+
+void playback_set_replay(Playback *playback, Replay *replay)
+{
+    playback->replay = replay;
+    playback->replay_index = 0;
+}
+
+void playback_set_frame_stats(Playback *playback, FrameStats *frame_stats)
+{
+    playback->frame_stats = frame_stats;
+}
+
+void playback_set_offset(Playback *playback, double offset)
+{
+    playback->offset = offset;
+}
+
 void playback_set_speed(Playback *playback, double speed)
 {
     playback->speed = speed;
@@ -51,13 +113,29 @@ void playback_set_speed(Playback *playback, double speed)
 
 void playback_start(Playback *playback, double delay)
 {
-    // set the playbacks start time
-    playback->start_time = time_milliseconds() + delay;
+    // start the playbacks clock delay milliseconds before the start of the chart
+    playback->clock_time = -delay;
+    playback->clock_update_time = time_nanoseconds();
+    playback->clock_held = false;
+    playback->last_audio_position = 0;
+
+    // reset the note and analog cursors, as time restarts from before the first note
+    playback->last_update_time = -delay;
+    reset_cursors(playback);
+
+    // restart the timeline from its first event
+    playback->timeline_index = 0;
+    playback->tempo_index = 0;
+    playback->finished = false;
+
+    // restart the replay from its first event
+    playback->replay_index = 0;
 }
 
 void update_current_notes(int num_lanes,
                           int num_notes[num_lanes],
                           Note *notes[num_lanes],
+                          int note_cursors[num_lanes],
                           int current_notes[num_lanes],
                           bool *chips_judged[num_lanes],
                           double time)
@@ -67,7 +145,8 @@ void update_current_notes(int num_lanes,
         // clear the current lanes current note
         current_notes[l] = INDEX_NONE;
 
-        for (int n = 0; n < num_notes[l]; n++)
+        // start from the current lanes cursor, as all notes before it have passed
+        for (int n = note_cursors[l]; n < num_notes[l]; n++)
         {
             Note *note = &notes[l][n];
 
@@ -93,6 +172,9 @@ void update_current_notes(int num_lanes,
             {
                 break;
             }
+
+            // the current note has passed and can never be in range again, so move the cursor past it
+            note_cursors[l] = n + 1;
         }
     }
 }
@@ -105,14 +187,21 @@ void update_current_analogs(Playback *playback, double time)
         playback->current_analogs[l] = INDEX_NONE;
         playback->current_analogs_points[l] = INDEX_NONE;
 
-        for (int a = 0; a < playback->chart->num_analogs[l]; a++)
+        // start from the current lanes cursor, as all segments before it have passed
+        int *analog_cursor = &playback->analog_cursors[l];
+        int *point_cursor = &playback->analog_point_cursors[l];
+
+        for (int a = *analog_cursor; a < playback->chart->num_analogs[l]; a++)
         {
             Analog *analog = &playback->chart->analogs[l][a];
 
             // whether or not this lane is finished finding a current segment
             bool lane_finished = false;
 
-            for (int p = 0; p < analog->num_points - 1; p++)
+            // only the cursors analog starts part way through its points
+            int first_point = (a == *analog_cursor) ? *point_cursor : 0;
+
+            for (int p = first_point; p < analog->num_points - 1; p++)
             {
                 AnalogPoint *start_point = &analog->points[p];
                 AnalogPoint *end_point = &analog->points[p + 1];
@@ -141,6 +230,10 @@ void update_current_analogs(Playback *playback, double time)
                     lane_finished = true;
                     break;
                 }
+
+                // the current segment has passed and can never be in range again, so move the cursor past it
+                *analog_cursor = a;
+                *point_cursor = p + 1;
             }
 
             // break if this lane is finished finding a current segment
@@ -199,6 +292,8 @@ void send_current_notes_events(Scoring *scoring,
 
 void update_current(Playback *playback, double time)
 {
+    trace_begin("update_current");
+
     // store the last notes to compare against the current
     int last_bt_notes[CHART_BT_LANES];
     int last_fx_notes[CHART_FX_LANES];
@@ -213,6 +308,7 @@ void update_current(Playback *playback, double time)
     update_current_notes(CHART_BT_LANES,
                          playback->chart->num_bt_notes,
                          playback->chart->bt_notes,
+                         playback->bt_note_cursors,
                          playback->current_bt_notes,
                          playback->scoring->bt_chips_judged,
                          time);
@@ -221,6 +317,7 @@ void update_current(Playback *playback, double time)
     update_current_notes(CHART_FX_LANES,
                          playback->chart->num_fx_notes,
                          playback->chart->fx_notes,
+                         playback->fx_note_cursors,
                          playback->current_fx_notes,
                          playback->scoring->fx_chips_judged,
                          time);
@@ -247,6 +344,8 @@ void update_current(Playback *playback, double time)
                               playback->chart->fx_notes,
                               scoring_fx_note_passed,
                               scoring_fx_note_current);
+
+    trace_end("update_current");
 }
 
 void update_current_hold_states(NoteMesh *note_mesh,
@@ -276,96 +375,47 @@ void update_current_hold_states(NoteMesh *note_mesh,
     }
 }
 
-void playback_tick(Playback *playback, double subbeat)
-{
-    // get the tick size for the current tempo
-    int tick_size = PLAYBACK_TICK_SIZE;
-    if (playback->chart->tempos[playback->tempo_index].bpm >= PLAYBACK_HALF_TICK_RATE_BPM)
-        tick_size *= 2;
-
-    // get the current tick
-    int tick = floor(subbeat / tick_size);
-
-    // if the current tick has changed since the last update
-    if (tick != playback->last_tick)
-    {
-        Judgement bt_hold_judgements[CHART_BT_LANES];
-        Judgement fx_hold_judgements[CHART_FX_LANES];
-
-        // tick the given playbacks scoring
-        scoring_tick_changed(playback->scoring,
-                             tick,
-                             tick * tick_size,
-                             bt_hold_judgements,
-                             fx_hold_judgements);
-
-        // todo: process the hold judgements
-    }
-
-    // set the given playbacks last tick
-    playback->last_tick = tick;
-}
-
-bool playback_update(Playback *playback)
+void advance_timeline(Playback *playback, double time)
 {
-    // get the current time, relative to start_time
-    double relative_time = time_milliseconds() - playback->start_time;
+    Timeline *timeline = playback->timeline;
 
-    // if playback has not yet started and time is past the start time
-    if (!playback->started && relative_time >= 0)
+    // process every event from the last update up to the given time, in order
+    // this way no note window or tick is skipped, however long it has been since the last update
+    while (playback->timeline_index < timeline->num_events &&
+           timeline->events[playback->timeline_index].time <= time)
     {
-        // start the audio
-        audio_track_play(playback->audio_track);
+        TimelineEvent *event = &timeline->events[playback->timeline_index++];
 
-        // mark the playback as started
-        playback->started = true;
-    }
+        switch (event->type)
+        {
+            case TimelineEventTempo:
+                // set the given playbacks tempo index
+                playback->tempo_index = event->index;
+                break;
+            case TimelineEventTick:
+            {
+                // update the current notes at the time of the tick so the correct holds are ticked
+                update_current(playback, event->time);
 
-    // say playback is finished if the current time is after the charts end time
-    if (relative_time >= playback->chart->end_time)
-        return true;
+                Judgement bt_hold_judgements[CHART_BT_LANES];
+                Judgement fx_hold_judgements[CHART_FX_LANES];
 
-    // update the given playbacks tempo index
-    for (int i = 0; i < playback->chart->num_tempos; i++)
-    {
-        // break if the current tempo is after relative time
-        if (playback->chart->tempos[i].time > relative_time)
-            break;
+                // tick the given playbacks scoring
+                scoring_tick_changed(playback->scoring,
+                                     event->index,
+                                     event->subbeat,
+                                     bt_hold_judgements,
+                                     fx_hold_judgements);
 
-        // set the given playbacks tempo index
-        playback->tempo_index = i;
+                // todo: process the hold judgements
+                break;
+            }
+            default:
+                // a note or slam window has changed, so update the current notes/analogs at the time of the event
+                update_current(playback, event->time);
+                break;
+        }
     }
-
-    // update the current notes/analogs
-    update_current(playback, relative_time);
-
-    // update the current bt and fx hold states
-    update_current_hold_states(playback->track->bt_mesh,
-                               CHART_BT_LANES,
-                               playback->chart->bt_notes,
-                               playback->current_bt_notes,
-                               relative_time,
-                               playback->scoring->bt_holds_held);
-
-    update_current_hold_states(playback->track->fx_mesh,
-                               CHART_FX_LANES,
-                               playback->chart->fx_notes,
-                               playback->current_fx_notes,
-                               relative_time,
-                               playback->scoring->fx_holds_held);
-
-    // get relative time in subbeats
-    double relative_time_subbeat = time_to_subbeat(playback->chart, playback->tempo_index, relative_time);
-
-    // tick the given playback
-    playback_tick(playback, relative_time_subbeat);
-
-    // draw the track
-    // draw at subbeat 0 if playback has not started yet so theres no scroll in before starting
-    track_draw(playback->track, playback->tempo_index, (!playback->started) ? 0 : relative_time_subbeat, playback->speed);
-
-    // say playback is not finished
-    return false;
 }
 
 void playback_note_state_changed(Playback *playback,
@@ -375,17 +425,15 @@ void playback_note_state_changed(Playback *playback,
                                  NoteMesh *note_mesh,
                                  int lane,
                                  bool pressed,
+                                 double time,
                                  Judgement (* scoring_state_changed)(Scoring *scoring, int, bool, double),
                                  void (* track_beam)(Track *, int, Judgement))
 {
     // assert that lane is valid
     assert(lane >= 0 && lane < num_lanes);
 
-    // get the current time relative to the given playbacks starts time
-    double relative_time = time_milliseconds() - playback->start_time;
-
     // pass the event to the given method
-    Judgement judgement = scoring_state_changed(playback->scoring, lane, pressed, relative_time);
+    Judgement judgement = scoring_state_changed(playback->scoring, lane, pressed, time);
 
     // if there was a judgement for the given lane and state
     if (judgement != JudgementNone)
@@ -404,8 +452,28 @@ void playback_note_state_changed(Playback *playback,
         track_beam(playback->track, lane, JudgementError);
 }
 
-void playback_bt_state_changed(Playback *playback, int lane, bool pressed)
+void record_replay_event(Playback *playback, InputEventType type, int lane, bool pressed, float value, double time)
+{
+    if (!playback->recording)
+        return;
+
+    // zero the event first so its padding is always written the same
+    ReplayEvent event;
+    memset(&event, 0, sizeof(ReplayEvent));
+    event.time = time;
+    event.state_time = playback->last_update_time;
+    event.value = value;
+    event.type = type;
+    event.lane = lane;
+    event.pressed = pressed;
+
+    replay_add_event(playback->recording, event);
+}
+
+void bt_state_changed(Playback *playback, int lane, bool pressed, double time)
 {
+    record_replay_event(playback, InputEventBt, lane, pressed, 0, time);
+
     // process the given event
     playback_note_state_changed(playback,
                                 CHART_BT_LANES,
@@ -414,12 +482,15 @@ void playback_bt_state_changed(Playback *playback, int lane, bool pressed)
                                 playback->track->bt_mesh,
                                 lane,
                                 pressed,
+                                time,
                                 scoring_bt_state_changed,
                                 track_bt_beam);
 }
 
-void playback_fx_state_changed(Playback *playback, int lane, bool pressed)
+void fx_state_changed(Playback *playback, int lane, bool pressed, double time)
 {
+    record_replay_event(playback, InputEventFx, lane, pressed, 0, time);
+
     // process the given event
     playback_note_state_changed(playback,
                                 CHART_FX_LANES,
@@ -428,6 +499,223 @@ void playback_fx_state_changed(Playback *playback, int lane, bool pressed)
                                 playback->track->fx_mesh,
                                 lane,
                                 pressed,
+                                time,
                                 scoring_fx_state_changed,
                                 track_fx_beam);
 }
+
+double clock_time_at(Playback *playback, int64_t time)
+{
+    // a held clock stays where it is until the audio catches up
+    if (playback->clock_held)
+        return playback->clock_time;
+
+    // get the chart time for the given time by running the given playbacks clock from its last update
+    return playback->clock_time + time_nanoseconds_to_milliseconds(time - playback->clock_update_time);
+}
+
+void update_clock(Playback *playback, int64_t time)
+{
+    // run the clock to the given time
+    double clock_time = clock_time_at(playback, time);
+
+    // correct the clock against the audio once it has started
+    // the audio position is only read when it changes, as between updates it lags behind the real position
+    if (playback->started)
+    {
+        double audio_position = audio_track_position(playback->audio_track);
+
+        if (audio_position != playback->last_audio_position)
+        {
+            playback->last_audio_position = audio_position;
+
+            // get how far the clock is from the audio
+            double error = (audio_position - playback->offset) - clock_time;
+
+            // release a held clock once the audio has caught up to it
+            if (playback->clock_held && error >= 0)
+                playback->clock_held = false;
+
+            // chart time must never move backwards, as the timeline would then process events twice
+            // so when the audio is far behind, such as when it first starts or stalls, hold the clock until it catches up
+            // when it is far ahead snap forward to it, otherwise correct a portion of the error,
+            // limited so that corrections are never visible and never take the clock back past where it was
+            if (error <= -PLAYBACK_CLOCK_SNAP_THRESHOLD)
+                playback->clock_held = true;
+            else if (error >= PLAYBACK_CLOCK_SNAP_THRESHOLD)
+                clock_time += error;
+            else if (!playback->clock_held)
+            {
+                clock_time += fmax(-PLAYBACK_CLOCK_MAX_CORRECTION, fmin(PLAYBACK_CLOCK_MAX_CORRECTION, error * PLAYBACK_CLOCK_GAIN));
+                clock_time = fmax(clock_time, playback->clock_time);
+            }
+        }
+    }
+
+    // set the given playbacks clock
+    playback->clock_time = clock_time;
+    playback->clock_update_time = time;
+}
+
+void playback_bt_state_changed(Playback *playback, int lane, bool pressed)
+{
+    // process the given event at the current chart time
+    bt_state_changed(playback, lane, pressed, clock_time_at(playback, time_nanoseconds()));
+}
+
+void playback_fx_state_changed(Playback *playback, int lane, bool pressed)
+{
+    // process the given event at the current chart time
+    fx_state_changed(playback, lane, pressed, clock_time_at(playback, time_nanoseconds()));
+}
+
+void process_event(Playback *playback, InputEventType type, int lane, bool pressed, float value, double time, double state_time)
+{
+    // bring the timeline and current notes up to the given state time so the event is judged against the notes of that time
+    // events read late can be from before the last update, in which case the current notes are already past them
+    if (state_time > playback->last_update_time)
+    {
+        advance_timeline(playback, state_time);
+        update_current(playback, state_time);
+        playback->last_update_time = state_time;
+    }
+
+    switch (type)
+    {
+        case InputEventBt:
+            bt_state_changed(playback, lane, pressed, time);
+            break;
+        case InputEventFx:
+            fx_state_changed(playback, lane, pressed, time);
+            break;
+        case InputEventKnob:
+            // todo: analog judgement
+            record_replay_event(playback, InputEventKnob, lane, false, value, time);
+            break;
+        default:
+            break;
+    }
+}
+
+void process_input(Playback *playback)
+{
+    InputEvent event;
+
+    // process every unread input event in the order they occured, at the chart time they occured at
+    // events that occured after the clock was updated this frame are clamped to the clock,
+    // so the timeline is never advanced past the time playback_update continues from
+    while (input_read_event(playback->input, &event))
+    {
+        double time = fmin(clock_time_at(playback, event.time), playback->clock_time);
+        process_event(playback, event.type, event.lane, event.pressed, event.value, time, time);
+    }
+}
+
+void process_replay(Playback *playback, double time)
+{
+    Replay *replay = playback->replay;
+
+    // process every replay event whose state was reached by the given time
+    // each is judged at the chart time it was recorded at, against the timeline as it was when it was recorded
+    while (playback->replay_index < replay->num_events &&
+           replay->events[playback->replay_index].state_time <= time)
+    {
+        ReplayEvent *event = &replay->events[playback->replay_index++];
+        process_event(playback, event->type, event->lane, event->pressed, event->value, event->time, event->state_time);
+    }
+}
+
+bool playback_update(Playback *playback)
+{
+    trace_begin("playback_update");
+
+    // update the clock and get the current chart time from it
+    int64_t update_start = time_nanoseconds();
+    update_clock(playback, update_start);
+    double relative_time = playback->clock_time;
+
+    // if playback has not yet started and time is past the start of the audio
+    if (!playback->started && relative_time + playback->offset >= 0)
+    {
+        // start the audio
+        // the clock keeps running until the audio position starts moving, which accounts for the latency of starting it
+        audio_track_play(playback->audio_track);
+
+        // mark the playback as started
+        playback->started = true;
+    }
+
+    // say playback is finished if the current time is after the charts end time
+    if (relative_time >= playback->chart->end_time)
+    {
+        // print the frame stats of the song the first time it finishes
+        if (!playback->finished && playback->frame_stats)
+            frame_stats_write_report(playback->frame_stats, stdout);
+
+        playback->finished = true;
+        trace_end("playback_update");
+        return true;
+    }
+
+    // reset the cursors if time has moved backwards, as notes and segments before them may be in range again
+    // the timeline is moved to the new time without processing the events in between
+    // the clock never moves backwards by itself, so this only happens when playback is restarted
+    if (relative_time < playback->last_update_time)
+    {
+        reset_cursors(playback);
+        playback->timeline_index = timeline_find(playback->timeline, relative_time);
+        playback->tempo_index = tempo_index_at_time(playback->chart, relative_time);
+
+        if (playback->replay)
+            playback->replay_index = replay_find(playback->replay, relative_time);
+    }
+
+    // process the replay or input events since the last update
+    if (playback->replay)
+        process_replay(playback, relative_time);
+    else if (playback->input)
+        process_input(playback);
+
+    playback->last_update_time = relative_time;
+
+    // process the timeline events since the last update
+    advance_timeline(playback, relative_time);
+
+    // update the current notes/analogs
+    update_current(playback, relative_time);
+
+    // update the current bt and fx hold states
+    update_current_hold_states(playback->track->bt_mesh,
+                               CHART_BT_LANES,
+                               playback->chart->bt_notes,
+                               playback->current_bt_notes,
+                               relative_time,
+                               playback->scoring->bt_holds_held);
+
+    update_current_hold_states(playback->track->fx_mesh,
+                               CHART_FX_LANES,
+                               playback->chart->fx_notes,
+                               playback->current_fx_notes,
+                               relative_time,
+                               playback->scoring->fx_holds_held);
+
+    // get relative time in subbeats
+    double relative_time_subbeat = time_to_subbeat(playback->chart, playback->tempo_index, relative_time);
+
+    // draw the track
+    // draw at subbeat 0 if playback has not started yet so theres no scroll in before starting
+    int64_t draw_start = time_nanoseconds();
+    track_draw(playback->track, playback->tempo_index, (!playback->started) ? 0 : relative_time_subbeat, playback->speed);
+
+    // record how long updating and drawing took
+    if (playback->frame_stats)
+    {
+        int64_t draw_end = time_nanoseconds();
+        frame_stats_record(playback->frame_stats, draw_start - update_start, draw_end - draw_start, relative_time);
+    }
+
+    trace_end("playback_update");
+
+    // say playback is not finished
+    return false;
+}
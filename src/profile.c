@@ -0,0 +1,123 @@
+#include "profile.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "timing.h"
+
+// the phases that have been recorded, in the order they began
+static ProfilePhase phases[PROFILE_MAX_PHASES];
+static int num_phases;
+
+// the phases that have begun but not ended, innermost last
+static int open_phases[PROFILE_MAX_DEPTH];
+static int num_open_phases;
+
+// the width of the name column of reports
+#define REPORT_NAME_WIDTH 48
+
+// the number of phases that were not recorded as the table was full
+static int num_dropped;
+
+int64_t cpu_time_nanoseconds()
+{
+    // get the cpu time used by every thread of the process
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * TIME_NANOSECONDS_PER_SECOND + ts.tv_nsec;
+}
+
+long rss_bytes()
+{
+    // read the resident pages from statm, the second field
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+
+    long size, resident = 0;
+    if (fscanf(file, "%li %li", &size, &resident) != 2)
+        resident = 0;
+
+    fclose(file);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+int profile_begin(const char *name)
+{
+    // drop the phase if there is no room for it
+    if (num_phases >= PROFILE_MAX_PHASES || num_open_phases >= PROFILE_MAX_DEPTH)
+    {
+        num_dropped++;
+        return -1;
+    }
+
+    // start the phase
+    int index = num_phases++;
+    ProfilePhase *phase = &phases[index];
+
+    strncpy(phase->name, name, PROFILE_NAME_SIZE - 1);
+    phase->name[PROFILE_NAME_SIZE - 1] = '\0';
+    phase->depth = num_open_phases;
+    phase->ended = false;
+    phase->start_rss = rss_bytes();
+    phase->start_cpu_time = cpu_time_nanoseconds();
+    phase->start_wall_time = time_nanoseconds();
+
+    open_phases[num_open_phases++] = index;
+    return index;
+}
+
+void profile_end(int phase)
+{
+    // dropped phases have nothing to end
+    if (phase < 0)
+        return;
+
+    // assert that the phase is the innermost open phase
+    assert(num_open_phases > 0 && open_phases[num_open_phases - 1] == phase);
+    num_open_phases--;
+
+    // finish the phase
+    ProfilePhase *ended = &phases[phase];
+    ended->wall_time = time_nanoseconds() - ended->start_wall_time;
+    ended->cpu_time = cpu_time_nanoseconds() - ended->start_cpu_time;
+    ended->rss_delta = rss_bytes() - ended->start_rss;
+    ended->ended = true;
+}
+
+void profile_write_report(FILE *file)
+{
+    fprintf(file, "%-*s %12s %12s %12s\n", REPORT_NAME_WIDTH, "phase", "wall ms", "cpu ms", "rss kb");
+
+    for (int i = 0; i < num_phases; i++)
+    {
+        ProfilePhase *phase = &phases[i];
+
+        // indent nested phases under the phase they are in
+        int indent = phase->depth * 2;
+        fprintf(file, "%*s%-*s", indent, "", REPORT_NAME_WIDTH - indent, phase->name);
+
+        if (phase->ended)
+        {
+            fprintf(file,
+                    " %12.3f %12.3f %+12li\n",
+                    time_nanoseconds_to_milliseconds(phase->wall_time),
+                    time_nanoseconds_to_milliseconds(phase->cpu_time),
+                    phase->rss_delta / 1024);
+        }
+        else
+            fprintf(file, " %12s\n", "unfinished");
+    }
+
+    if (num_dropped > 0)
+        fprintf(file, "%i phases were not recorded, raise PROFILE_MAX_PHASES\n", num_dropped);
+}
+
+void profile_reset()
+{
+    num_phases = 0;
+    num_open_phases = 0;
+    num_dropped = 0;
+}
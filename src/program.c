@@ -2,9 +2,18 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include "shader.h"
+#include "program_cache.h"
+#include "render_state.h"
+#include "gl_stats.h"
+#include "profile.h"
+
+// the programs that currently exist
+static Program *programs[PROGRAM_MAX_PROGRAMS];
+static int num_programs;
 
 void program_print_log(GLuint program)
 {
@@ -38,38 +47,82 @@ void program_assert_error(GLuint program, GLenum pname)
     assert(check == GL_TRUE);
 }
 
-Program *program_create(const char *vertex_source_path, const char *fragment_source_path, bool accepts_pvm_matrices)
+Program *program_create(const char *vertex_source_path, const char *fragment_source_path, bool accepts_mvp)
 {
+    // share the existing program if one was already created from the given sources
+    for (int i = 0; i < num_programs; i++)
+    {
+        Program *program = programs[i];
+        if (strcmp(program->vertex_source_path, vertex_source_path) == 0 &&
+            strcmp(program->fragment_source_path, fragment_source_path) == 0)
+        {
+            assert(program->accepts_mvp == accepts_mvp);
+            program->references++;
+            return program;
+        }
+    }
+
+    // assert that there is room for another program
+    assert(num_programs < PROGRAM_MAX_PROGRAMS);
+
+    // profile each program separately, as compiling is the slow part of loading
+    char profile_name[PROFILE_NAME_SIZE];
+    snprintf(profile_name, sizeof(profile_name), "program_create %s+%s", vertex_source_path, fragment_source_path);
+    int profile_phase = profile_begin(profile_name);
+
     // create the program
     Program *program = malloc(sizeof(Program));
     program->id = glCreateProgram();
-    program->accepts_pvm_matrices = accepts_pvm_matrices;
+    program->vertex_id = 0;
+    program->fragment_id = 0;
+    program->vertex_source_path = strdup(vertex_source_path);
+    program->fragment_source_path = strdup(fragment_source_path);
+    program->references = 1;
+    program->accepts_mvp = accepts_mvp;
+    program->mvp_set = false;
+    program->attributes = 0;
+
+    // read the sources
+    char *vertex_source = shader_read_source(vertex_source_path);
+    char *fragment_source = shader_read_source(fragment_source_path);
+
+    // load the cached binary of the program, or compile and link it if there is none
+    uint64_t hash = program_cache_hash(vertex_source, fragment_source);
+    if (!program_cache_load(program->id, vertex_source_path, fragment_source_path, hash))
+    {
+        // create the vertex and fragment shaders
+        shader_create(&program->vertex_id, GL_VERTEX_SHADER, vertex_source_path, vertex_source);
+        shader_create(&program->fragment_id, GL_FRAGMENT_SHADER, fragment_source_path, fragment_source);
+
+        // attach the vertex and fragment shaders
+        glAttachShader(program->id, program->vertex_id);
+        glAttachShader(program->id, program->fragment_id);
+
+        // link the program
+        glLinkProgram(program->id);
 
-    // create the vertex and fragment shaders
-    shader_create(&program->vertex_id, GL_VERTEX_SHADER, vertex_source_path);
-    shader_create(&program->fragment_id, GL_FRAGMENT_SHADER, fragment_source_path);
+        // make sure there are no link errors
+        program_assert_error(program->id, GL_LINK_STATUS);
+
+        // cache the linked program for next time
+        program_cache_write(program->id, vertex_source_path, fragment_source_path, hash);
+    }
 
-    // attach the vertex and fragment shaders
-    glAttachShader(program->id, program->vertex_id);
-    glAttachShader(program->id, program->fragment_id);
+    free(vertex_source);
+    free(fragment_source);
 
-    // link the program
-    glLinkProgram(program->id);
+    // keep the program so it can be shared
+    programs[num_programs++] = program;
 
-    // make sure there are no link errors
-    program_assert_error(program->id, GL_LINK_STATUS);
+    profile_end(profile_phase);
 
-    // get the matrices uniforms if the vertex shader accepts pvm matrices
-    if (accepts_pvm_matrices)
+    // get the mvp uniform if the vertex shader accepts an mvp matrix
+    if (accepts_mvp)
     {
-        program->uniform_projection_id = program_get_uniform_id(program, "projection");
-        program->uniform_view_id = program_get_uniform_id(program, "view");
-        program->uniform_model_id = program_get_uniform_id(program, "model");
-
-        // assert that all the uniforms were found
-        assert(program->uniform_projection_id >= 0);
-        assert(program->uniform_view_id >= 0);
-        assert(program->uniform_model_id >= 0);
+        program->uniform_mvp_id = glGetUniformLocation(program->id, "mvp");
+
+        // assert that the uniform was found
+        assert(program->uniform_mvp_id >= 0);
     }
 
     // return the program
@@ -78,9 +131,31 @@ Program *program_create(const char *vertex_source_path, const char *fragment_sou
 
 void program_free(Program *program)
 {
-    glDeleteShader(program->vertex_id);
-    glDeleteShader(program->fragment_id);
+    // only delete the program once nothing uses it
+    if (--program->references > 0)
+        return;
+
+    // remove the program from the existing programs, moving the last program into its slot
+    for (int i = 0; i < num_programs; i++)
+    {
+        if (programs[i] == program)
+        {
+            programs[i] = programs[--num_programs];
+            break;
+        }
+    }
+
+    // release the shaders, if the program was compiled
+    if (program->vertex_id != 0)
+        shader_free(program->vertex_id);
+
+    if (program->fragment_id != 0)
+        shader_free(program->fragment_id);
+
+    render_state_forget_program(program->id);
     glDeleteProgram(program->id);
+    free(program->vertex_source_path);
+    free(program->fragment_source_path);
     free(program);
 }
 
@@ -91,21 +166,33 @@ GLuint program_get_uniform_id(Program *program, const GLchar *name)
 
 GLuint program_get_attribute_id(Program *program, const GLchar *name)
 {
-    return glGetAttribLocation(program->id, name);
+    GLint id = glGetAttribLocation(program->id, name);
+
+    // keep track of the attributes this program uses so program_use can disable the rest
+    if (id >= 0 && id < RENDER_STATE_MAX_ATTRIBUTES)
+        program->attributes |= 1u << id;
+
+    return id;
 }
 
 void program_use(Program *program)
 {
-    glUseProgram(program->id);
+    // use the program and disable any attributes left enabled by other programs that this program does not use
+    render_state_use_program(program->id);
+    render_state_limit_attributes(program->attributes);
 }
 
-void program_set_matrices(Program *program, mat4_t projection, mat4_t view, mat4_t model)
+void program_set_mvp(Program *program, mat4_t mvp)
 {
-    // assert that the vertex shader accepts pvm matrices
-    assert(program->accepts_pvm_matrices);
+    // assert that the vertex shader accepts an mvp matrix
+    assert(program->accepts_mvp);
+
+    // skip setting the matrix if it is unchanged, as uniforms keep their values while a program is not in use
+    if (program->mvp_set && memcmp(&program->mvp, &mvp, sizeof(mat4_t)) == 0)
+        return;
 
-    // set the matrices
-    glUniformMatrix4fv(program->uniform_projection_id, 1, GL_FALSE, &projection.m[0][0]);
-    glUniformMatrix4fv(program->uniform_view_id, 1, GL_FALSE, &view.m[0][0]);
-    glUniformMatrix4fv(program->uniform_model_id, 1, GL_FALSE, &model.m[0][0]);
+    // set the matrix
+    glUniformMatrix4fv(program->uniform_mvp_id, 1, GL_FALSE, &mvp.m[0][0]);
+    program->mvp = mvp;
+    program->mvp_set = true;
 }
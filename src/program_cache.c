@@ -0,0 +1,193 @@
+#include "program_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+
+#include "path.h"
+#include "shader.h"
+
+// fnv-1a 64 bit constants
+#define PROGRAM_CACHE_HASH_OFFSET 0xcbf29ce484222325ULL
+#define PROGRAM_CACHE_HASH_PRIME 0x100000001b3ULL
+
+// the program binary extension functions, loaded once by program_cache_supported
+static bool extension_checked;
+static PFNGLGETPROGRAMBINARYOESPROC get_program_binary;
+static PFNGLPROGRAMBINARYOESPROC program_binary;
+
+bool program_cache_supported()
+{
+    // only check for the extension once
+    if (!extension_checked)
+    {
+        extension_checked = true;
+
+        // the extension must be listed and have at least one binary format
+        const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+        GLint num_formats = 0;
+        if (extensions && strstr(extensions, "GL_OES_get_program_binary"))
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &num_formats);
+
+        if (num_formats > 0)
+        {
+            get_program_binary = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+            program_binary = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+        }
+    }
+
+    return get_program_binary && program_binary;
+}
+
+void hash_string(uint64_t *hash, const char *string)
+{
+    // hash the string including its terminator, so adjacent strings cannot run together
+    do
+    {
+        *hash ^= (uint8_t)*string;
+        *hash *= PROGRAM_CACHE_HASH_PRIME;
+    } while (*string++);
+}
+
+uint64_t program_cache_hash(const char *vertex_source, const char *fragment_source)
+{
+    uint64_t hash = PROGRAM_CACHE_HASH_OFFSET;
+
+    // hash the sources as they are compiled, with the precision that shader_create prefixes fragment shaders with
+    hash_string(&hash, vertex_source);
+    hash_string(&hash, SHADER_FRAGMENT_PRECISION);
+    hash_string(&hash, fragment_source);
+
+    // hash the driver, as binaries are only valid for the driver that created them
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+    const char *version = (const char *)glGetString(GL_VERSION);
+    hash_string(&hash, renderer ? renderer : "");
+    hash_string(&hash, version ? version : "");
+
+    return hash;
+}
+
+void program_cache_path(const char *vertex_source_path, const char *fragment_source_path, char output_path[PATH_MAX])
+{
+    // name the cache after both of the programs shaders
+    char relative_path[PATH_MAX];
+    snprintf(relative_path, PATH_MAX, "%s/%s+%s.bin", PROGRAM_CACHE_DIRECTORY, vertex_source_path, fragment_source_path);
+    path_get_relative(relative_path, output_path);
+}
+
+bool program_cache_load(GLuint program, const char *vertex_source_path, const char *fragment_source_path, uint64_t hash)
+{
+    if (!program_cache_supported())
+        return false;
+
+    // open the cache file, which is not an error if it does not exist yet
+    char path[PATH_MAX];
+    program_cache_path(vertex_source_path, fragment_source_path, path);
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    // read and check the header
+    ProgramCacheHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PROGRAM_CACHE_VERSION ||
+        header.source_hash != hash)
+    {
+        fclose(file);
+        return false;
+    }
+
+    // read the binary
+    void *binary = malloc(header.binary_size);
+    bool read = fread(binary, header.binary_size, 1, file) == 1;
+    fclose(file);
+
+    if (!read)
+    {
+        free(binary);
+        return false;
+    }
+
+    // load the binary into the program
+    program_binary(program, header.binary_format, binary, header.binary_size);
+    free(binary);
+
+    // the driver may still reject the binary, e.g. after an update that kept its version string
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        printf("program_cache_load: rejected cached program %s\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+void program_cache_write(GLuint program, const char *vertex_source_path, const char *fragment_source_path, uint64_t hash)
+{
+    if (!program_cache_supported())
+        return;
+
+    // get the binary of the program
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0)
+        return;
+
+    void *binary = malloc(length);
+    GLenum format;
+    get_program_binary(program, length, &length, &format, binary);
+
+    // make sure the cache directory exists
+    char directory[PATH_MAX];
+    path_get_relative(PROGRAM_CACHE_DIRECTORY, directory);
+    mkdir(directory, 0755);
+
+    // write the header and binary to a temporary file and move it over the cache once finished
+    // so an interrupted write never leaves a partial cache behind
+    // failing to write the cache is not an error, the program is just compiled again next time
+    char path[PATH_MAX];
+    char temporary_path[PATH_MAX + 4];
+    program_cache_path(vertex_source_path, fragment_source_path, path);
+    snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+    FILE *file = fopen(temporary_path, "wb");
+    if (!file)
+    {
+        printf("program_cache_write: unable to write %s\n", path);
+        free(binary);
+        return;
+    }
+
+    ProgramCacheHeader header =
+    {
+        .version = PROGRAM_CACHE_VERSION,
+        .source_hash = hash,
+        .binary_format = format,
+        .binary_size = length,
+    };
+
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary, length, 1, file);
+    free(binary);
+
+    // only replace the cache if everything was written
+    bool failed = ferror(file);
+    failed |= fclose(file) != 0;
+
+    if (failed || rename(temporary_path, path) != 0)
+    {
+        printf("program_cache_write: unable to write %s\n", path);
+        unlink(temporary_path);
+    }
+}
@@ -0,0 +1,97 @@
+#include "render_queue.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "render_state.h"
+
+RenderQueue *render_queue_create()
+{
+    // create the queue
+    RenderQueue *queue = malloc(sizeof(RenderQueue));
+    queue->num_commands = 0;
+
+    // return the queue
+    return queue;
+}
+
+void render_queue_free(RenderQueue *queue)
+{
+    free(queue);
+}
+
+void render_queue_clear(RenderQueue *queue)
+{
+    queue->num_commands = 0;
+}
+
+void render_queue_add(RenderQueue *queue,
+                      uint8_t pass,
+                      RenderBlend blend,
+                      Program *program,
+                      GLuint buffer_id,
+                      RenderDrawFunction draw,
+                      void *context,
+                      void *data)
+{
+    // assert that there is room for the command
+    assert(queue->num_commands < RENDER_QUEUE_MAX_COMMANDS);
+
+    // build the key with the pass in the highest bits, so it is sorted by first
+    // gl ids are small, so 24 bits each is plenty for the program and buffer
+    uint64_t key = ((uint64_t)pass << 56) |
+                   ((uint64_t)(blend & 0xff) << 48) |
+                   ((uint64_t)(program->id & 0xffffff) << 24) |
+                   ((uint64_t)(buffer_id & 0xffffff));
+
+    queue->commands[queue->num_commands] = (RenderCommand)
+    {
+        .key = key,
+        .order = queue->num_commands,
+        .blend = blend,
+        .draw = draw,
+        .context = context,
+        .data = data,
+    };
+
+    queue->num_commands++;
+}
+
+int compare_commands(const void *a, const void *b)
+{
+    const RenderCommand *command_a = a;
+    const RenderCommand *command_b = b;
+
+    // sort by key, then by the order the commands were added in
+    if (command_a->key != command_b->key)
+        return (command_a->key < command_b->key) ? -1 : 1;
+
+    return command_a->order - command_b->order;
+}
+
+void render_queue_submit(RenderQueue *queue)
+{
+    // sort the commands so their state changes are grouped
+    qsort(queue->commands, queue->num_commands, sizeof(RenderCommand), compare_commands);
+
+    // draw each command with its blending
+    for (int i = 0; i < queue->num_commands; i++)
+    {
+        RenderCommand *command = &queue->commands[i];
+
+        switch (command->blend)
+        {
+            case RenderBlendNormal:
+                render_state_set_blend(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+            case RenderBlendAdditive:
+                render_state_set_blend(GL_SRC_ALPHA, GL_ONE);
+                break;
+        }
+
+        command->draw(command->context, command->data);
+    }
+
+    // clear the queue for the next frame
+    render_queue_clear(queue);
+}
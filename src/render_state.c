@@ -0,0 +1,195 @@
+#include "render_state.h"
+
+#include "gl_stats.h"
+
+// zeroed, so nothing is known until it is first set
+static RenderState state;
+
+// count a change, returning whether or not it should be passed to gl
+bool count_change(bool needed)
+{
+    if (needed)
+        state.stats.changes++;
+    else
+        state.stats.saved++;
+
+    return needed;
+}
+
+bool attribute_tracked(GLuint attribute_id)
+{
+    return attribute_id < RENDER_STATE_MAX_ATTRIBUTES;
+}
+
+void render_state_reset()
+{
+    // forget everything but the stats
+    state.program_known = false;
+    state.blend_known = false;
+    state.buffer_known = false;
+    state.index_buffer_known = false;
+    state.attributes_known = 0;
+
+    // assume every attribute may be enabled, so they get disabled when they are not needed
+    state.attributes_enabled = ~(uint32_t)0;
+}
+
+void render_state_use_program(GLuint program_id)
+{
+    if (count_change(!state.program_known || state.program_id != program_id))
+    {
+        glUseProgram(program_id);
+        state.program_id = program_id;
+        state.program_known = true;
+    }
+}
+
+void render_state_set_blend(GLenum source, GLenum destination)
+{
+    if (count_change(!state.blend_known ||
+                     state.blend_source != source ||
+                     state.blend_destination != destination))
+    {
+        glBlendFunc(source, destination);
+        state.blend_source = source;
+        state.blend_destination = destination;
+        state.blend_known = true;
+    }
+}
+
+void render_state_bind_buffer(GLuint buffer_id)
+{
+    if (count_change(!state.buffer_known || state.buffer_id != buffer_id))
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+        state.buffer_id = buffer_id;
+        state.buffer_known = true;
+    }
+}
+
+void render_state_bind_index_buffer(GLuint buffer_id)
+{
+    if (count_change(!state.index_buffer_known || state.index_buffer_id != buffer_id))
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer_id);
+        state.index_buffer_id = buffer_id;
+        state.index_buffer_known = true;
+    }
+}
+
+void set_attribute_pointer(GLuint attribute_id, RenderStateAttribute *attribute)
+{
+    render_state_bind_buffer(attribute->buffer_id);
+    glVertexAttribPointer(attribute_id,
+                          attribute->size,
+                          attribute->type,
+                          attribute->normalized,
+                          attribute->stride,
+                          (const GLvoid *)attribute->offset);
+}
+
+void render_state_set_attribute(GLuint attribute_id, GLuint buffer_id, GLint size)
+{
+    render_state_set_attribute_format(attribute_id, (RenderStateAttribute)
+    {
+        .buffer_id = buffer_id,
+        .size = size,
+        .type = GL_FLOAT,
+        .normalized = GL_FALSE,
+        .stride = 0,
+        .offset = 0,
+    });
+}
+
+void render_state_set_attribute_format(GLuint attribute_id, RenderStateAttribute attribute)
+{
+    // pass untracked attributes straight to gl
+    if (!attribute_tracked(attribute_id))
+    {
+        glEnableVertexAttribArray(attribute_id);
+        set_attribute_pointer(attribute_id, &attribute);
+        return;
+    }
+
+    uint32_t bit = 1u << attribute_id;
+
+    // enable the attribute
+    if (count_change(!(state.attributes_enabled & bit)))
+    {
+        glEnableVertexAttribArray(attribute_id);
+        state.attributes_enabled |= bit;
+    }
+
+    // point the attribute at the given buffer
+    // the pointer captures the bound buffer, so the buffer only needs binding when the pointer changes
+    RenderStateAttribute *current = &state.attributes[attribute_id];
+    if (count_change(!(state.attributes_known & bit) ||
+                     current->buffer_id != attribute.buffer_id ||
+                     current->size != attribute.size ||
+                     current->type != attribute.type ||
+                     current->normalized != attribute.normalized ||
+                     current->stride != attribute.stride ||
+                     current->offset != attribute.offset))
+    {
+        set_attribute_pointer(attribute_id, &attribute);
+        *current = attribute;
+        state.attributes_known |= bit;
+    }
+}
+
+void render_state_disable_attribute(GLuint attribute_id)
+{
+    // pass untracked attributes straight to gl
+    if (!attribute_tracked(attribute_id))
+    {
+        glDisableVertexAttribArray(attribute_id);
+        return;
+    }
+
+    uint32_t bit = 1u << attribute_id;
+    if (count_change(state.attributes_enabled & bit))
+    {
+        glDisableVertexAttribArray(attribute_id);
+        state.attributes_enabled &= ~bit;
+    }
+}
+
+void render_state_limit_attributes(uint32_t attributes)
+{
+    // disable each enabled attribute that is not in the given attributes
+    for (GLuint i = 0; i < RENDER_STATE_MAX_ATTRIBUTES; i++)
+        if ((state.attributes_enabled & ~attributes) & (1u << i))
+            render_state_disable_attribute(i);
+}
+
+void render_state_forget_program(GLuint program_id)
+{
+    if (state.program_known && state.program_id == program_id)
+        state.program_known = false;
+}
+
+void render_state_forget_buffer(GLuint buffer_id)
+{
+    // deleting a bound buffer unbinds it
+    if (state.buffer_known && state.buffer_id == buffer_id)
+        state.buffer_known = false;
+
+    if (state.index_buffer_known && state.index_buffer_id == buffer_id)
+        state.index_buffer_known = false;
+
+    // forget any attribute pointers into the buffer
+    for (int i = 0; i < RENDER_STATE_MAX_ATTRIBUTES; i++)
+        if (state.attributes[i].buffer_id == buffer_id)
+            state.attributes_known &= ~(1u << i);
+}
+
+void render_state_end_frame()
+{
+    state.last_stats = state.stats;
+    state.stats = (RenderStateStats){ 0 };
+}
+
+RenderStateStats render_state_last_frame_stats()
+{
+    return state.last_stats;
+}
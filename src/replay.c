@@ -0,0 +1,147 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+Replay *replay_create()
+{
+    // create the replay
+    Replay *replay = malloc(sizeof(Replay));
+    replay->num_events = 0;
+    replay->max_events = REPLAY_INITIAL_EVENTS;
+    replay->events = malloc(replay->max_events * sizeof(ReplayEvent));
+
+    // return the replay
+    return replay;
+}
+
+Replay *replay_load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    // read and validate the header
+    ReplayHeader header;
+    if (fread(&header, sizeof(ReplayHeader), 1, file) != 1 ||
+        memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != REPLAY_VERSION ||
+        header.event_size != sizeof(ReplayEvent))
+    {
+        printf("replay_load: '%s' is not a valid replay\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    // make sure the file actually holds the number of events the header says it does
+    // so a corrupt count can never size the allocation
+    struct stat file_stat;
+    if (fstat(fileno(file), &file_stat) != 0 ||
+        file_stat.st_size < sizeof(ReplayHeader) ||
+        header.num_events > (file_stat.st_size - sizeof(ReplayHeader)) / sizeof(ReplayEvent) ||
+        header.num_events > INT_MAX)
+    {
+        printf("replay_load: '%s' is truncated\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    // create the replay and read the events
+    // always allocate at least one event so replay_add_event has something to grow
+    Replay *replay = malloc(sizeof(Replay));
+    replay->num_events = header.num_events;
+    replay->max_events = (header.num_events > 0) ? header.num_events : 1;
+    replay->events = malloc(replay->max_events * sizeof(ReplayEvent));
+
+    if (!replay->events)
+    {
+        printf("replay_load: unable to allocate %d events for '%s'\n", replay->max_events, path);
+        free(replay);
+        fclose(file);
+        return NULL;
+    }
+
+    if (fread(replay->events, sizeof(ReplayEvent), replay->num_events, file) != (size_t)replay->num_events)
+    {
+        printf("replay_load: '%s' is truncated\n", path);
+        replay_free(replay);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+
+    // return the replay
+    return replay;
+}
+
+void replay_free(Replay *replay)
+{
+    free(replay->events);
+    free(replay);
+}
+
+void replay_add_event(Replay *replay, ReplayEvent event)
+{
+    // grow the events if they are full
+    if (replay->num_events >= replay->max_events)
+    {
+        replay->max_events *= 2;
+        replay->events = realloc(replay->events, replay->max_events * sizeof(ReplayEvent));
+    }
+
+    replay->events[replay->num_events++] = event;
+}
+
+bool replay_write(Replay *replay, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        printf("replay_write: unable to write replay '%s'\n", path);
+        return false;
+    }
+
+    ReplayHeader header =
+    {
+        .version = REPLAY_VERSION,
+        .event_size = sizeof(ReplayEvent),
+        .num_events = replay->num_events,
+    };
+
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+
+    // write the header and events
+    fwrite(&header, sizeof(ReplayHeader), 1, file);
+    fwrite(replay->events, sizeof(ReplayEvent), replay->num_events, file);
+
+    bool failed = ferror(file);
+    failed |= fclose(file) != 0;
+
+    if (failed)
+        printf("replay_write: unable to write replay '%s'\n", path);
+
+    return !failed;
+}
+
+int replay_find(Replay *replay, double time)
+{
+    // get the index of the first event after the given time
+    int low = 0;
+    int high = replay->num_events;
+
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if (replay->events[middle].state_time <= time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
@@ -1,9 +1,15 @@
 #include "screen.h"
 
+#include <stdlib.h>
 #include <assert.h>
-#include <bcm_host.h>
 #include <GLES2/gl2.h>
 
+#include "render_state.h"
+#include "gl_stats.h"
+#include "profile.h"
+#include "trace.h"
+#include "timing.h"
+
 void gl_assert()
 {
     assert(glGetError() == 0);
@@ -11,28 +17,8 @@ void gl_assert()
 
 Screen *screen_create()
 {
-    // init bcm for getting a frambuffer output
-    bcm_host_init();
-
-    // dispman handles
-    static EGL_DISPMANX_WINDOW_T window;
-    DISPMANX_ELEMENT_HANDLE_T dispman_element;
-    DISPMANX_DISPLAY_HANDLE_T dispman_display;
-    DISPMANX_UPDATE_HANDLE_T dispman_update;
-
-    // dispman alpha
-    VC_DISPMANX_ALPHA_T dispman_alpha =
-    {
-        DISPMANX_FLAGS_ALPHA_FIXED_NON_ZERO, //flags
-        255, //opacity
-    };
-
-    // rects for screen and output resolution
-    VC_RECT_T screen_rect;
-    VC_RECT_T display_rect;
-
     // egl attributes
-    static const EGLint attributes[] =
+    const EGLint attributes[] =
     {
         EGL_RED_SIZE, 8,
         EGL_GREEN_SIZE, 8,
@@ -40,7 +26,9 @@ Screen *screen_create()
         EGL_ALPHA_SIZE, 8,
         EGL_DEPTH_SIZE, 16,
         EGL_SURFACE_TYPE,
-        EGL_WINDOW_BIT,
+        screen_backend_surface_type(),
+        EGL_RENDERABLE_TYPE,
+        EGL_OPENGL_ES2_BIT,
         EGL_SAMPLE_BUFFERS, 1,
         EGL_SAMPLES, 4, //4x msaa
         EGL_NONE,
@@ -53,12 +41,14 @@ Screen *screen_create()
         EGL_NONE,
     };
 
+    int profile_phase = profile_begin("screen_create");
+
     EGLBoolean result;
     Screen *screen = malloc(sizeof(Screen));
     EGLConfig config;
 
-    // get an egl display connection
-    screen->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    // get an egl display connection from the backend
+    screen->display = screen_backend_get_display();
     assert(screen->display != EGL_NO_DISPLAY);
     gl_assert();
 
@@ -70,7 +60,7 @@ Screen *screen_create()
     // get an appropriate egl framebuffer configuration
     EGLint num_config;
     result = eglChooseConfig(screen->display, attributes, &config, 1, &num_config);
-    assert(result != EGL_FALSE);
+    assert(result != EGL_FALSE && num_config > 0);
     gl_assert();
 
     // get an approiate egl api
@@ -83,43 +73,8 @@ Screen *screen_create()
     assert(screen->context != EGL_NO_CONTEXT);
     gl_assert();
 
-    // create an egl window surface
-    // set display_rect to the resolution of the screen
-    int32_t success = 0;
-
-    display_rect.x = 0;
-    display_rect.y = 0;
-    success = graphics_get_display_size(SCREEN_NUMBER, &display_rect.width, &display_rect.height);
-    assert(success >= 0);
-
-    // set screen_rect to the resolution specified by SCREEN_WIDTH and SCREEN_HEIGHT
-    screen_rect.x = 0;
-    screen_rect.y = 0;
-    screen_rect.width = SCREEN_WIDTH << 16;
-    screen_rect.height = SCREEN_HEIGHT << 16;
-
-    // get dispman handles
-    dispman_display = vc_dispmanx_display_open(SCREEN_NUMBER);
-    dispman_update = vc_dispmanx_update_start(0);
-    dispman_element = vc_dispmanx_element_add(dispman_update,
-                                              dispman_display,
-                                              0,
-                                              &display_rect,
-                                              0,
-                                              &screen_rect,
-                                              DISPMANX_PROTECTION_NONE,
-                                              &dispman_alpha,
-                                              0,
-                                              (DISPMANX_TRANSFORM_T)0);
-
-    // create the dispman window
-    window.element = dispman_element;
-    window.width = SCREEN_WIDTH;
-    window.height = SCREEN_HEIGHT;
-    vc_dispmanx_update_submit_sync(dispman_update);
-
-    // create the egl surface
-    screen->surface = eglCreateWindowSurface(screen->display, config, &window, NULL);
+    // create the egl surface from the backend
+    screen->surface = screen_backend_create_surface(screen->display, config);
     assert(screen->surface != EGL_NO_SURFACE);
     gl_assert();
 
@@ -128,6 +83,11 @@ Screen *screen_create()
     assert(result != EGL_FALSE);
     gl_assert();
 
+    // the new context has none of the state that render_state may have tracked from a previous one
+    render_state_reset();
+
+    profile_end(profile_phase);
+
     // return the screen
     return screen;
 }
@@ -137,8 +97,27 @@ void screen_free(Screen *screen)
     free(screen);
 }
 
-void screen_update(Screen *screen)
+int64_t screen_update(Screen *screen)
 {
     // swap the screen buffers
+    // traced and timed on its own, as it blocks while the gpu catches up
+    int64_t swap_start = time_nanoseconds();
+    trace_begin("eglSwapBuffers");
     eglSwapBuffers(screen->display, screen->surface);
+    trace_end("eglSwapBuffers");
+    int64_t swap_duration = time_nanoseconds() - swap_start;
+
+    // start counting gl state changes and calls for the next frame
+    render_state_end_frame();
+    gl_stats_end_frame();
+
+    // count the gl work of the finished frame
+    RenderStateStats render_stats = render_state_last_frame_stats();
+    trace_counter("gl_state_changes", render_stats.changes);
+    trace_counter("gl_state_changes_saved", render_stats.saved);
+
+    // write the trace and stop if the process was interrupted during the frame
+    trace_handle_signals();
+
+    return swap_duration;
 }
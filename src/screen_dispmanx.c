@@ -0,0 +1,75 @@
+#include "screen.h"
+
+#include <assert.h>
+#include <bcm_host.h>
+
+EGLDisplay screen_backend_get_display()
+{
+    // init bcm for getting a frambuffer output
+    bcm_host_init();
+
+    // use the default display, which is the framebuffer
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+EGLint screen_backend_surface_type()
+{
+    return EGL_WINDOW_BIT;
+}
+
+EGLSurface screen_backend_create_surface(EGLDisplay display, EGLConfig config)
+{
+    // dispman handles
+    static EGL_DISPMANX_WINDOW_T window;
+    DISPMANX_ELEMENT_HANDLE_T dispman_element;
+    DISPMANX_DISPLAY_HANDLE_T dispman_display;
+    DISPMANX_UPDATE_HANDLE_T dispman_update;
+
+    // dispman alpha
+    VC_DISPMANX_ALPHA_T dispman_alpha =
+    {
+        DISPMANX_FLAGS_ALPHA_FIXED_NON_ZERO, //flags
+        255, //opacity
+    };
+
+    // rects for screen and output resolution
+    VC_RECT_T screen_rect;
+    VC_RECT_T display_rect;
+
+    // set display_rect to the resolution of the screen
+    int32_t success = 0;
+
+    display_rect.x = 0;
+    display_rect.y = 0;
+    success = graphics_get_display_size(SCREEN_NUMBER, &display_rect.width, &display_rect.height);
+    assert(success >= 0);
+
+    // set screen_rect to the resolution specified by SCREEN_WIDTH and SCREEN_HEIGHT
+    screen_rect.x = 0;
+    screen_rect.y = 0;
+    screen_rect.width = SCREEN_WIDTH << 16;
+    screen_rect.height = SCREEN_HEIGHT << 16;
+
+    // get dispman handles
+    dispman_display = vc_dispmanx_display_open(SCREEN_NUMBER);
+    dispman_update = vc_dispmanx_update_start(0);
+    dispman_element = vc_dispmanx_element_add(dispman_update,
+                                              dispman_display,
+                                              0,
+                                              &display_rect,
+                                              0,
+                                              &screen_rect,
+                                              DISPMANX_PROTECTION_NONE,
+                                              &dispman_alpha,
+                                              0,
+                                              (DISPMANX_TRANSFORM_T)0);
+
+    // create the dispman window
+    window.element = dispman_element;
+    window.width = SCREEN_WIDTH;
+    window.height = SCREEN_HEIGHT;
+    vc_dispmanx_update_submit_sync(dispman_update);
+
+    // create the egl surface
+    return eglCreateWindowSurface(display, config, &window, NULL);
+}
@@ -0,0 +1,39 @@
+#include "screen.h"
+
+#include <stdio.h>
+#include <EGL/eglext.h>
+
+EGLDisplay screen_backend_get_display()
+{
+    // use the surfaceless platform if it is available, so no window system or gpu is needed
+    // e.g. mesa with llvmpipe
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display)
+    {
+        EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY)
+            return display;
+    }
+
+    // fall back to the default display
+    printf("screen_backend_get_display: surfaceless platform unavailable, using the default display\n");
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+EGLint screen_backend_surface_type()
+{
+    return EGL_PBUFFER_BIT;
+}
+
+EGLSurface screen_backend_create_surface(EGLDisplay display, EGLConfig config)
+{
+    // render offscreen to a pbuffer the size of the screen
+    const EGLint surface_attributes[] =
+    {
+        EGL_WIDTH, SCREEN_WIDTH,
+        EGL_HEIGHT, SCREEN_HEIGHT,
+        EGL_NONE,
+    };
+
+    return eglCreatePbufferSurface(display, config, surface_attributes);
+}
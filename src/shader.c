@@ -7,6 +7,10 @@
 
 #include "path.h"
 
+// the shaders that currently exist
+static Shader shaders[SHADER_MAX_SHADERS];
+static int num_shaders;
+
 void shader_print_log(GLuint shader)
 {
     // make sure shader is actually a shader
@@ -39,11 +43,8 @@ void shader_assert_error(GLuint shader, GLenum pname)
     assert(check == GL_TRUE);
 }
 
-void shader_create(GLuint *shader, GLenum type, const char *source_path)
+char *shader_read_source(const char *source_path)
 {
-    // create the shader
-    *shader = glCreateShader(type);
-
     // get the source path relative to the binary directory
     char relative_source_path[PATH_MAX];
     strcpy(relative_source_path, "shaders/");
@@ -80,14 +81,69 @@ void shader_create(GLuint *shader, GLenum type, const char *source_path)
     // terminate the buffer
     buffer[length] = '\0';
 
+    return buffer;
+}
+
+void shader_create(GLuint *shader, GLenum type, const char *source_path, const char *source)
+{
+    // share the existing shader if this one was already compiled
+    for (int i = 0; i < num_shaders; i++)
+    {
+        if (shaders[i].type == type && strcmp(shaders[i].source_path, source_path) == 0)
+        {
+            shaders[i].references++;
+            *shader = shaders[i].id;
+            return;
+        }
+    }
+
+    // assert that there is room for another shader
+    assert(num_shaders < SHADER_MAX_SHADERS);
+
+    // create the shader
+    *shader = glCreateShader(type);
+
     // set the shader source and compile
-    const GLchar *source = (GLchar *)buffer;
-    glShaderSource(*shader, 1, &source, NULL);
+    // fragment shaders have no default float precision, which the pi driver allows but stricter drivers do not
+    // so they are given one ahead of their source
+    const GLchar *sources[] =
+    {
+        (type == GL_FRAGMENT_SHADER) ? SHADER_FRAGMENT_PRECISION : "",
+        (const GLchar *)source,
+    };
+
+    glShaderSource(*shader, 2, sources, NULL);
     glCompileShader(*shader);
 
-    // free the buffer as it is now loaded into the shader
-    free(buffer);
-
     // make sure there are no compilation errors
     shader_assert_error(*shader, GL_COMPILE_STATUS);
+
+    // keep the shader so it can be shared
+    shaders[num_shaders++] = (Shader)
+    {
+        .type = type,
+        .source_path = strdup(source_path),
+        .id = *shader,
+        .references = 1,
+    };
+}
+
+void shader_free(GLuint shader)
+{
+    for (int i = 0; i < num_shaders; i++)
+    {
+        if (shaders[i].id != shader)
+            continue;
+
+        // only delete the shader once nothing uses it
+        if (--shaders[i].references > 0)
+            return;
+
+        glDeleteShader(shader);
+        free(shaders[i].source_path);
+
+        // move the last shader into the freed slot
+        shaders[i] = shaders[--num_shaders];
+        return;
+    }
 }
@@ -0,0 +1,224 @@
+#include "timeline.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "judgement.h"
+#include "note_utils.h"
+
+void add_event(TimelineEvent *events, int *num_events, TimelineEvent event)
+{
+    // only write the event when not counting
+    if (events)
+        events[*num_events] = event;
+
+    *num_events += 1;
+}
+
+// the first time after the given time, used for leave events
+// windows include their end time, so a note only leaves its window just after it
+double time_after(double time)
+{
+    return nextafter(time, INFINITY);
+}
+
+void add_note_events(TimelineEvent *events,
+                     int *num_events,
+                     int num_lanes,
+                     int num_notes[num_lanes],
+                     Note *notes[num_lanes],
+                     TimelineEventType enter_type,
+                     TimelineEventType leave_type)
+{
+    for (int l = 0; l < num_lanes; l++)
+    {
+        for (int n = 0; n < num_notes[l]; n++)
+        {
+            Note *note = &notes[l][n];
+
+            // get the maximum timing window of the current note
+            double enter_time, leave_time;
+
+            if (note->hold)
+            {
+                enter_time = note->start_time - JUDGEMENT_HOLD_START_WINDOW;
+                leave_time = note->end_time;
+            }
+            else
+            {
+                enter_time = note->start_time - JUDGEMENT_ERROR_WINDOW;
+                leave_time = note->start_time + JUDGEMENT_ERROR_WINDOW;
+            }
+
+            add_event(events, num_events, (TimelineEvent)
+            {
+                .time = enter_time,
+                .index = n,
+                .type = enter_type,
+                .lane = l,
+            });
+
+            add_event(events, num_events, (TimelineEvent)
+            {
+                .time = time_after(leave_time),
+                .index = n,
+                .type = leave_type,
+                .lane = l,
+            });
+        }
+    }
+}
+
+int add_events(Chart *chart, TimelineEvent *events)
+{
+    int num_events = 0;
+
+    // add the tempo events
+    for (int i = 0; i < chart->num_tempos; i++)
+    {
+        add_event(events, &num_events, (TimelineEvent)
+        {
+            .time = chart->tempos[i].time,
+            .index = i,
+            .type = TimelineEventTempo,
+        });
+    }
+
+    // add the bt and fx note events
+    add_note_events(events,
+                    &num_events,
+                    CHART_BT_LANES,
+                    chart->num_bt_notes,
+                    chart->bt_notes,
+                    TimelineEventBtEnter,
+                    TimelineEventBtLeave);
+
+    add_note_events(events,
+                    &num_events,
+                    CHART_FX_LANES,
+                    chart->num_fx_notes,
+                    chart->fx_notes,
+                    TimelineEventFxEnter,
+                    TimelineEventFxLeave);
+
+    // add the slam events
+    for (int l = 0; l < CHART_ANALOG_LANES; l++)
+    {
+        for (int a = 0; a < chart->num_analogs[l]; a++)
+        {
+            Analog *analog = &chart->analogs[l][a];
+
+            for (int p = 0; p < analog->num_points - 1; p++)
+            {
+                AnalogPoint *start_point = &analog->points[p];
+                AnalogPoint *end_point = &analog->points[p + 1];
+
+                // only slams have a timing window
+                if (!end_point->slam)
+                    continue;
+
+                add_event(events, &num_events, (TimelineEvent)
+                {
+                    .time = start_point->time - JUDGEMENT_ANALOG_SLAM_WINDOW,
+                    .index = a,
+                    .subbeat = p,
+                    .type = TimelineEventSlamEnter,
+                    .lane = l,
+                });
+
+                add_event(events, &num_events, (TimelineEvent)
+                {
+                    .time = time_after(end_point->time + JUDGEMENT_ANALOG_SLAM_WINDOW),
+                    .index = a,
+                    .subbeat = p,
+                    .type = TimelineEventSlamLeave,
+                    .lane = l,
+                });
+            }
+        }
+    }
+
+    // add the tick events
+    // each tick is aligned to the tick size of the tempo it is in
+    uint32_t subbeat = 0;
+    while (subbeat < chart->end_subbeat)
+    {
+        // get the tick size for the tempo at the current subbeat
+        int tick_size = TIMELINE_TICK_SIZE;
+        if (chart->tempos[tempo_index_at_subbeat(chart, subbeat)].bpm >= TIMELINE_HALF_TICK_RATE_BPM)
+            tick_size *= 2;
+
+        add_event(events, &num_events, (TimelineEvent)
+        {
+            .time = subbeat_to_time(chart, subbeat),
+            .index = subbeat / tick_size,
+            .subbeat = subbeat,
+            .type = TimelineEventTick,
+        });
+
+        // move to the next tick
+        subbeat = (subbeat / tick_size + 1) * tick_size;
+    }
+
+    return num_events;
+}
+
+int compare_events(const void *a, const void *b)
+{
+    const TimelineEvent *event_a = a;
+    const TimelineEvent *event_b = b;
+
+    // sort by time, then by type so that leaves come before enters and ticks come last
+    if (event_a->time != event_b->time)
+        return (event_a->time < event_b->time) ? -1 : 1;
+    if (event_a->type != event_b->type)
+        return event_a->type - event_b->type;
+    if (event_a->lane != event_b->lane)
+        return event_a->lane - event_b->lane;
+    if (event_a->index != event_b->index)
+        return event_a->index - event_b->index;
+
+    return event_a->subbeat - event_b->subbeat;
+}
+
+Timeline *timeline_create(Chart *chart)
+{
+    // create the timeline
+    Timeline *timeline = malloc(sizeof(Timeline));
+
+    // count, then allocate and add all the events of the given chart
+    timeline->num_events = add_events(chart, NULL);
+    timeline->events = malloc(timeline->num_events * sizeof(TimelineEvent));
+    add_events(chart, timeline->events);
+
+    // sort the events by time
+    qsort(timeline->events, timeline->num_events, sizeof(TimelineEvent), compare_events);
+
+    // return the timeline
+    return timeline;
+}
+
+void timeline_free(Timeline *timeline)
+{
+    free(timeline->events);
+    free(timeline);
+}
+
+int timeline_find(Timeline *timeline, double time)
+{
+    // get the index of the first event after the given time
+    int low = 0;
+    int high = timeline->num_events;
+
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+
+        if (timeline->events[middle].time <= time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
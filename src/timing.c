@@ -1,14 +1,49 @@
 #include "timing.h"
 
 #include <stdlib.h>
-#include <sys/time.h>
+#include <time.h>
+#include <errno.h>
 
-double time_milliseconds()
+int64_t time_nanoseconds()
 {
-    // get the current time of day
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
+    // get the current monotonic time
+    // CLOCK_MONOTONIC rather than CLOCK_MONOTONIC_RAW as it is the clock clock_nanosleep can sleep against
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    // convert tv_sec and tv_usec to ms and return
-    return (tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0);
+    // convert tv_sec and tv_nsec to ns and return
+    return ts.tv_sec * TIME_NANOSECONDS_PER_SECOND + ts.tv_nsec;
+}
+
+double time_nanoseconds_to_milliseconds(int64_t nanoseconds)
+{
+    return (double)nanoseconds / TIME_NANOSECONDS_PER_MILLISECOND;
+}
+
+int64_t time_milliseconds_to_nanoseconds(double milliseconds)
+{
+    return (int64_t)(milliseconds * TIME_NANOSECONDS_PER_MILLISECOND);
+}
+
+int64_t time_deadline(int64_t duration)
+{
+    return time_nanoseconds() + duration;
+}
+
+bool time_deadline_passed(int64_t deadline)
+{
+    return time_nanoseconds() >= deadline;
+}
+
+void time_sleep_until(int64_t deadline)
+{
+    // convert the deadline to a timespec
+    struct timespec ts =
+    {
+        .tv_sec = deadline / TIME_NANOSECONDS_PER_SECOND,
+        .tv_nsec = deadline % TIME_NANOSECONDS_PER_SECOND,
+    };
+
+    // sleep until the deadline, resuming the sleep if it is interrupted by a signal
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
 }
@@ -0,0 +1,177 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "timing.h"
+
+// the size of the buffer events are formatted into before being written
+#define WRITE_BUFFER_SIZE 256
+
+// whether or not events are being recorded
+static bool enabled;
+
+// the recorded events, as a ring buffer
+// the index of an event in events is its number modulo TRACE_MAX_EVENTS
+static TraceEvent events[TRACE_MAX_EVENTS];
+static unsigned int events_written;
+
+// the path to write the events to on exit, if any
+static const char *exit_path;
+
+// the number of the SIGINT or SIGTERM that was received, or 0 if neither was
+// only set by the signal handler, the trace is written by trace_handle_signals outside of it
+static volatile sig_atomic_t received_signal;
+
+void record_event(const char *name, TraceEventType type, double value)
+{
+    TraceEvent *event = &events[events_written++ & (TRACE_MAX_EVENTS - 1)];
+    event->time = time_nanoseconds();
+    event->name = name;
+    event->value = value;
+    event->type = type;
+}
+
+void trace_set_enabled(bool value)
+{
+    enabled = value;
+}
+
+bool trace_enabled()
+{
+    return enabled;
+}
+
+void trace_begin(const char *name)
+{
+    if (enabled)
+        record_event(name, TraceEventBegin, 0);
+}
+
+void trace_end(const char *name)
+{
+    if (enabled)
+        record_event(name, TraceEventEnd, 0);
+}
+
+void trace_counter(const char *name, double value)
+{
+    if (enabled)
+        record_event(name, TraceEventCounter, value);
+}
+
+void write_buffer(int fd, const char *buffer, int length)
+{
+    // snprintf returns the length it would have written, so clamp it to what actually fit in the buffer
+    if (length < 0)
+        return;
+
+    if (length >= WRITE_BUFFER_SIZE)
+        length = WRITE_BUFFER_SIZE - 1;
+
+    write(fd, buffer, length);
+}
+
+bool trace_write_json(const char *path)
+{
+    // stop recording so the events dont change while writing
+    bool was_enabled = enabled;
+    enabled = false;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        enabled = was_enabled;
+        return false;
+    }
+
+    char buffer[WRITE_BUFFER_SIZE];
+    int length = snprintf(buffer, sizeof(buffer), "{\"traceEvents\":[\n");
+    write_buffer(fd, buffer, length);
+
+    // write the events from oldest to newest
+    // once the ring buffer has wrapped, the oldest event is the one that will be overwritten next
+    unsigned int first = (events_written > TRACE_MAX_EVENTS) ? events_written - TRACE_MAX_EVENTS : 0;
+    for (unsigned int i = first; i < events_written; i++)
+    {
+        TraceEvent *event = &events[i & (TRACE_MAX_EVENTS - 1)];
+        const char *separator = (i + 1 < events_written) ? "," : "";
+
+        // chrome trace timestamps are in microseconds
+        double timestamp = (double)event->time / 1000.0;
+
+        switch (event->type)
+        {
+            case TraceEventBegin:
+            case TraceEventEnd:
+                length = snprintf(buffer,
+                                  sizeof(buffer),
+                                  "{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+                                  event->name,
+                                  (event->type == TraceEventBegin) ? "B" : "E",
+                                  timestamp,
+                                  separator);
+                break;
+            case TraceEventCounter:
+                length = snprintf(buffer,
+                                  sizeof(buffer),
+                                  "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%g}}%s\n",
+                                  event->name,
+                                  timestamp,
+                                  event->value,
+                                  separator);
+                break;
+        }
+
+        write_buffer(fd, buffer, length);
+    }
+
+    length = snprintf(buffer, sizeof(buffer), "]}\n");
+    write_buffer(fd, buffer, length);
+    close(fd);
+
+    enabled = was_enabled;
+    return true;
+}
+
+void write_exit_trace()
+{
+    trace_write_json(exit_path);
+}
+
+void signal_received(int signal_number)
+{
+    // writing the trace is not async signal safe, so only note the signal for trace_handle_signals
+    received_signal = signal_number;
+}
+
+void trace_handle_signals()
+{
+    if (!received_signal)
+        return;
+
+    // write the trace, then stop the process as it would have been without the handler
+    trace_write_json(exit_path);
+    signal(received_signal, SIG_DFL);
+    raise(received_signal);
+}
+
+void trace_write_json_on_exit(const char *path)
+{
+    // only register the handlers the first time
+    bool registered = exit_path != NULL;
+    exit_path = path;
+
+    if (registered)
+        return;
+
+    atexit(write_exit_trace);
+
+    struct sigaction action = { .sa_handler = signal_received, .sa_flags = SA_RESTART };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
@@ -13,6 +13,9 @@
 #include "fx_mesh.h"
 #include "note_utils.h"
 #include "interpolate.h"
+#include "gl_stats.h"
+#include "profile.h"
+#include "trace.h"
 
 void create_beam_mesh(Program *program,
                       Mesh **mesh,
@@ -34,14 +37,32 @@ void create_beam_mesh(Program *program,
 
 Track *track_create(Chart *chart)
 {
+    int profile_phase = profile_begin("track_create");
+
     // create the track
     Track *track = malloc(sizeof(Track));
 
     // set the track properties
     track->chart = chart;
 
+    // create the projection matrix
+    mat4_t projection = m4_perspective(90.0f,
+                                       (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT,
+                                       0.1f,
+                                       TRACK_LENGTH + -TRACK_CAMERA_OFFSET);
+
+    // create the view matrix
+    mat4_t view = m4_look_at(vec3(0, 0, -TRACK_LENGTH + TRACK_CAMERA_OFFSET),
+                             vec3(0, TRACK_VISUAL_OFFSET, 0),
+                             vec3(0, 1, 0));
+
+    view = m4_mul(view, m4_rotation_x(86.0f / 180.0f * M_PI));
+
+    // combine the projection and view matrices
+    track->view_projection = m4_mul(projection, view);
+
     // default the beam times so they arent triggered when the track is loaded
-    double hidden_time = time_milliseconds() - TRACK_BEAM_DURATION;
+    int64_t hidden_time = time_nanoseconds() - time_milliseconds_to_nanoseconds(TRACK_BEAM_DURATION);
 
     for (int i = 0; i < CHART_BT_LANES; i++)
         track->bt_beam_states[i].time = hidden_time;
@@ -54,6 +75,9 @@ Track *track_create(Chart *chart)
     track->uniform_lane_lane_id = program_get_uniform_id(track->lane_program, "lane");
     track->lane_mesh = mesh_create(MESH_VERTICES_QUAD * (CHART_ANALOG_LANES + 1), track->lane_program, GL_STATIC_DRAW);
 
+    // build the lane mesh on the cpu and upload it once
+    mesh_stage_vertices(track->lane_mesh);
+
     // set the note lane vertices
     mesh_set_vertices_quad(track->lane_mesh,
                            0,
@@ -83,6 +107,8 @@ Track *track_create(Chart *chart)
                                position);
     }
 
+    mesh_upload_vertices(track->lane_mesh);
+
     // create the beam program
     track->beam_program = program_create("beam.vs", "beam.fs", true);
     track->uniform_beam_judgement_id = program_get_uniform_id(track->beam_program, "judgement");
@@ -104,6 +130,11 @@ Track *track_create(Chart *chart)
     track->fx_mesh = fx_mesh_create(chart);
     track->analog_mesh = analog_mesh_create(chart);
 
+    // create the render queue
+    track->render_queue = render_queue_create();
+
+    profile_end(profile_phase);
+
     // return the track
     return track;
 }
@@ -125,6 +156,9 @@ void track_free(Track *track)
     note_mesh_free(track->fx_mesh);
     analog_mesh_free(track->analog_mesh);
 
+    // free the render queue
+    render_queue_free(track->render_queue);
+
     // free the track
     free(track);
 }
@@ -152,7 +186,7 @@ void note_beam(int num_lanes,
     // set the beam state for the given lanes properties
     BeamState *state = &states[lane];
     state->judgement = judgement;
-    state->time = time_milliseconds();
+    state->time = time_nanoseconds();
 }
 
 void track_bt_beam(Track *track, int lane, Judgement judgement)
@@ -176,8 +210,6 @@ void track_fx_beam(Track *track, int lane, Judgement judgement)
 void draw_beams(Track *track,
                 int num_lanes,
                 BeamState states[num_lanes],
-                mat4_t projection,
-                mat4_t view,
                 mat4_t model,
                 Mesh *mesh,
                 float lane_width,
@@ -186,8 +218,8 @@ void draw_beams(Track *track,
     // use the beam program
     program_use(track->beam_program);
 
-    // get the current time in milliseconds
-    double time = time_milliseconds();
+    // get the current time
+    int64_t time = time_nanoseconds();
 
     // for each lane
     for (int i = 0; i < num_lanes; i++)
@@ -195,13 +227,16 @@ void draw_beams(Track *track,
         // get the current lanes beams state
         BeamState *state = &states[i];
 
+        // get the time in milliseconds since the beam was triggered
+        double beam_time = time_nanoseconds_to_milliseconds(time - state->time);
+
         // only draw the beam if its animation is still occurring
-        if (state->time + TRACK_BEAM_DURATION >= time)
+        if (beam_time <= TRACK_BEAM_DURATION)
         {
             // get the current beams current alpha
-            double current_alpha = interpolate(time,
-                                               state->time,
-                                               state->time + TRACK_BEAM_DURATION,
+            double current_alpha = interpolate(beam_time,
+                                               0,
+                                               TRACK_BEAM_DURATION,
                                                start_alpha,
                                                0);
 
@@ -209,8 +244,8 @@ void draw_beams(Track *track,
             glUniform1i(track->uniform_beam_judgement_id, state->judgement);
             glUniform1f(track->uniform_beam_alpha_id, current_alpha);
 
-            // set the programs matrices
-            program_set_matrices(track->beam_program, projection, view, model);
+            // set the programs matrix
+            program_set_mvp(track->beam_program, m4_mul(track->view_projection, model));
 
             // draw the current beam
             mesh_draw_all(mesh);
@@ -221,28 +256,19 @@ void draw_beams(Track *track,
     }
 }
 
-void track_draw(Track *track, int tempo_index, double subbeat, double speed)
-{
-    // create the projection matrix
-    mat4_t projection = m4_perspective(90.0f,
-                                       (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT,
-                                       0.1f,
-                                       TRACK_LENGTH + -TRACK_CAMERA_OFFSET);
-
-    // create the view matrix
-    mat4_t view = m4_look_at(vec3(0, 0, -TRACK_LENGTH + TRACK_CAMERA_OFFSET),
-                             vec3(0, TRACK_VISUAL_OFFSET, 0),
-                             vec3(0, 1, 0));
+//
+// draw commands
+// each is called with the track as context, and what it draws as data
+//
 
-    view = m4_mul(view, m4_rotation_x(86.0f / 180.0f * M_PI));
+void draw_lane_command(void *context, void *data)
+{
+    Track *track = context;
 
-    // create the model matrix
-    mat4_t model = m4_identity();
-    model = m4_mul(model, m4_translation(vec3(0, -TRACK_LENGTH / 2, 0))); //move the track so the end point is at 0,0,0
+    trace_begin("draw_lane");
 
-    // draw the lane
     program_use(track->lane_program);
-    program_set_matrices(track->lane_program, projection, view, model);
+    program_set_mvp(track->lane_program, m4_mul(track->view_projection, track->frame.model));
     mesh_draw_start(track->lane_mesh);
 
     for (int i = 0; i < 1 + CHART_ANALOG_LANES; i++)
@@ -253,50 +279,144 @@ void track_draw(Track *track, int tempo_index, double subbeat, double speed)
 
     mesh_draw_end(track->lane_mesh);
 
-    // get the model for vertices starting at the beginning of the track
-    mat4_t offset_model = m4_mul(model, m4_translation(vec3(0, -TRACK_LENGTH / 2, 0)));
-
-    // get the model for vertices scrolling with the track
-    mat4_t scrolled_model = m4_mul(offset_model, m4_translation(vec3(0, -track_subbeat_position(subbeat) * speed, 0)));
-
-    // get the start and end subbeat of the given subbeat for drawing
-    int subbeats_per_track = ceil(TRACK_LENGTH / (track_beat_size() * speed)) * CHART_BEAT_SUBBEATS;
-    int extra_subbeats = CHART_BEAT_SUBBEATS * 2;
-    uint16_t start_subbeat = subbeat - extra_subbeats;
-    uint16_t end_subbeat = subbeat + subbeats_per_track + extra_subbeats;
+    trace_end("draw_lane");
+}
 
-    // draw the measure bars
-    measure_bar_mesh_draw(track->measure_bar_mesh, projection, view, scrolled_model, start_subbeat, end_subbeat, speed);
+void draw_bt_beams_command(void *context, void *data)
+{
+    Track *track = context;
 
-    // normal blending for beams
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    trace_begin("draw_bt_beams");
 
-    // draw the bt beams
     draw_beams(track,
                CHART_BT_LANES,
                track->bt_beam_states,
-               projection,
-               view,
-               model,
+               track->frame.model,
                track->bt_beam_mesh,
                BT_MESH_NOTE_WIDTH,
                TRACK_BT_BEAM_ALPHA);
 
-    // draw the fx beams
+    trace_end("draw_bt_beams");
+}
+
+void draw_fx_beams_command(void *context, void *data)
+{
+    Track *track = context;
+
+    trace_begin("draw_fx_beams");
+
     draw_beams(track,
                CHART_FX_LANES,
                track->fx_beam_states,
-               projection,
-               view,
-               model,
+               track->frame.model,
                track->fx_beam_mesh,
                FX_MESH_NOTE_WIDTH,
                TRACK_FX_BEAM_ALPHA);
 
-    // draw all the notes and analogs in order
-    note_mesh_draw_holds(track->fx_mesh, projection, view, scrolled_model, start_subbeat, end_subbeat, speed); //fx holds
-    note_mesh_draw_holds(track->bt_mesh, projection, view, scrolled_model, start_subbeat, end_subbeat, speed); //bt holds
-    note_mesh_draw_chips(track->fx_mesh, projection, view, scrolled_model, start_subbeat, end_subbeat, speed); //fx chips
-    note_mesh_draw_chips(track->bt_mesh, projection, view, scrolled_model, start_subbeat, end_subbeat, speed); //bt chip
-    analog_mesh_draw(track->analog_mesh, projection, view, offset_model, track_subbeat_position(subbeat), start_subbeat, end_subbeat, speed); //analogs
+    trace_end("draw_fx_beams");
+}
+
+void draw_measure_bars_command(void *context, void *data)
+{
+    Track *track = context;
+    TrackFrame *frame = &track->frame;
+
+    trace_begin("draw_measure_bars");
+
+    measure_bar_mesh_draw(data, track->view_projection, frame->scrolled_model, frame->start_subbeat, frame->end_subbeat, frame->speed);
+
+    trace_end("draw_measure_bars");
+}
+
+void draw_holds_command(void *context, void *data)
+{
+    Track *track = context;
+    TrackFrame *frame = &track->frame;
+
+    trace_begin("draw_holds");
+
+    note_mesh_draw_holds(data, track->view_projection, frame->scrolled_model, frame->start_subbeat, frame->end_subbeat, frame->speed);
+
+    trace_end("draw_holds");
+}
+
+void draw_chips_command(void *context, void *data)
+{
+    Track *track = context;
+    TrackFrame *frame = &track->frame;
+
+    trace_begin("draw_chips");
+
+    note_mesh_draw_chips(data, track->view_projection, frame->scrolled_model, frame->start_subbeat, frame->end_subbeat, frame->speed);
+
+    trace_end("draw_chips");
+}
+
+void draw_analogs_command(void *context, void *data)
+{
+    Track *track = context;
+    TrackFrame *frame = &track->frame;
+
+    trace_begin("draw_analogs");
+
+    analog_mesh_draw(data,
+                     track->view_projection,
+                     frame->offset_model,
+                     track_subbeat_position(frame->subbeat),
+                     frame->start_subbeat,
+                     frame->end_subbeat,
+                     frame->speed);
+
+    trace_end("draw_analogs");
+}
+
+void track_draw(Track *track, int tempo_index, double subbeat, double speed)
+{
+    trace_begin("track_draw");
+
+    TrackFrame *frame = &track->frame;
+    RenderQueue *queue = track->render_queue;
+
+    // create the model matrix
+    mat4_t model = m4_identity();
+    model = m4_mul(model, m4_translation(vec3(0, -TRACK_LENGTH / 2, 0))); //move the track so the end point is at 0,0,0
+    frame->model = model;
+
+    // get the model for vertices starting at the beginning of the track
+    frame->offset_model = m4_mul(model, m4_translation(vec3(0, -TRACK_LENGTH / 2, 0)));
+
+    // get the model for vertices scrolling with the track
+    frame->scrolled_model = m4_mul(frame->offset_model, m4_translation(vec3(0, -track_subbeat_position(subbeat) * speed, 0)));
+
+    // get the start and end subbeat of the given subbeat for drawing
+    int subbeats_per_track = ceil(TRACK_LENGTH / (track_beat_size() * speed)) * CHART_BEAT_SUBBEATS;
+    int extra_subbeats = CHART_BEAT_SUBBEATS * 2;
+    frame->start_subbeat = subbeat - extra_subbeats;
+    frame->end_subbeat = subbeat + subbeats_per_track + extra_subbeats;
+    frame->subbeat = subbeat;
+    frame->speed = speed;
+
+    // add the draw commands of the frame
+    // passes keep the layers in order, and within a pass commands sharing state are drawn together
+    render_queue_add(queue, TrackPassLane, RenderBlendNormal, track->lane_program, track->lane_mesh->vertex_buffer_id, draw_lane_command, track, NULL);
+
+    MeasureBarMesh *measure_bar_mesh = track->measure_bar_mesh;
+    render_queue_add(queue, TrackPassMeasureBars, RenderBlendNormal, measure_bar_mesh->program, measure_bar_mesh->mesh->vertex_buffer_id, draw_measure_bars_command, track, measure_bar_mesh);
+
+    render_queue_add(queue, TrackPassBtBeams, RenderBlendNormal, track->beam_program, track->bt_beam_mesh->vertex_buffer_id, draw_bt_beams_command, track, NULL);
+    render_queue_add(queue, TrackPassFxBeams, RenderBlendNormal, track->beam_program, track->fx_beam_mesh->vertex_buffer_id, draw_fx_beams_command, track, NULL);
+
+    NoteMesh *bt_mesh = track->bt_mesh, *fx_mesh = track->fx_mesh;
+    render_queue_add(queue, TrackPassHolds, RenderBlendAdditive, fx_mesh->holds_program, fx_mesh->holds_mesh->vertex_buffer_id, draw_holds_command, track, fx_mesh);
+    render_queue_add(queue, TrackPassHolds, RenderBlendAdditive, bt_mesh->holds_program, bt_mesh->holds_mesh->vertex_buffer_id, draw_holds_command, track, bt_mesh);
+    render_queue_add(queue, TrackPassFxChips, RenderBlendNormal, fx_mesh->chips_program, fx_mesh->chips_mesh->vertex_buffer_id, draw_chips_command, track, fx_mesh);
+    render_queue_add(queue, TrackPassBtChips, RenderBlendNormal, bt_mesh->chips_program, bt_mesh->chips_mesh->vertex_buffer_id, draw_chips_command, track, bt_mesh);
+
+    AnalogMesh *analog_mesh = track->analog_mesh;
+    render_queue_add(queue, TrackPassAnalogs, RenderBlendAdditive, analog_mesh->program, analog_mesh->mesh->vertex_buffer_id, draw_analogs_command, track, analog_mesh);
+
+    // draw the frame
+    render_queue_submit(queue);
+
+    trace_end("track_draw");
 }